@@ -0,0 +1,149 @@
+#include "ogl_tools.h"
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <boost/iostreams/filter/counter.hpp>
+#include <boost/iostreams/device/file.hpp>
+
+namespace jep
+{
+	bool hasExtension(const string &path, const string &extension)
+	{
+		return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+	compression_type compressed_reader::getCompression(const char* file_path)
+	{
+		string path(file_path);
+
+		if (hasExtension(path, ".gz"))
+			return GZIP_COMPRESSION;
+
+		if (hasExtension(path, ".zst"))
+			return ZSTD_COMPRESSION;
+
+		return NO_COMPRESSION;
+	}
+
+	compressed_reader::compressed_reader(const char* file_path, std::size_t block_size, int blocks_ahead) :
+		file_path(file_path), compression(getCompression(file_path)), block_size(std::max<std::size_t>(block_size, 1)),
+		blocks_ahead(std::max(blocks_ahead, 1)), compressed_size(0), compressed_read(0), open(false),
+		finished(false), stopping(false)
+	{
+		std::ifstream file(file_path, std::ios::in | std::ios::binary | std::ios::ate);
+
+		//no decompressor is started, so nextBlock has to see the reader as already finished
+		if (!file.is_open())
+		{
+			error = "unable to open compressed file: " + this->file_path;
+			finished = true;
+			return;
+		}
+
+		compressed_size = std::size_t(file.tellg());
+		file.close();
+
+		open = true;
+		decompressor = std::thread(&compressed_reader::decompress, this);
+	}
+
+	compressed_reader::~compressed_reader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(reader_mutex);
+			stopping = true;
+		}
+
+		block_taken.notify_all();
+
+		if (decompressor.joinable())
+			decompressor.join();
+	}
+
+	bool compressed_reader::nextBlock(string &block)
+	{
+		std::unique_lock<std::mutex> lock(reader_mutex);
+		block_added.wait(lock, [this]() { return !blocks.empty() || finished; });
+
+		if (blocks.empty())
+			return false;
+
+		block.swap(blocks.front());
+		blocks.pop_front();
+
+		lock.unlock();
+		block_taken.notify_one();
+
+		return true;
+	}
+
+	const string compressed_reader::getError() const
+	{
+		std::lock_guard<std::mutex> lock(reader_mutex);
+		return error;
+	}
+
+	//runs on the background thread
+	void compressed_reader::decompress()
+	{
+		string failure;
+
+		try
+		{
+			boost::iostreams::filtering_istream input;
+
+			if (compression == GZIP_COMPRESSION)
+				input.push(boost::iostreams::gzip_decompressor());
+
+			else if (compression == ZSTD_COMPRESSION)
+				input.push(boost::iostreams::zstd_decompressor());
+
+			//counts the compressed bytes the decompressor has pulled from the file
+			input.push(boost::iostreams::counter());
+			input.push(boost::iostreams::file_source(file_path, std::ios::in | std::ios::binary));
+
+			//decoding errors surface as exceptions rather than a bare badbit, set once the chain is complete
+			input.exceptions(std::ios::badbit);
+
+			boost::iostreams::counter* compressed_counter = input.component<boost::iostreams::counter>(input.size() - 2);
+
+			while (true)
+			{
+				string block(block_size, '\0');
+				input.read(&block[0], block_size);
+				block.resize(std::size_t(input.gcount()));
+
+				if (compressed_counter != nullptr)
+					compressed_read = std::size_t(compressed_counter->characters());
+
+				if (block.empty())
+					break;
+
+				std::unique_lock<std::mutex> lock(reader_mutex);
+				block_taken.wait(lock, [this]() { return blocks.size() < blocks_ahead || stopping; });
+
+				if (stopping)
+					return;
+
+				blocks.push_back(string());
+				blocks.back().swap(block);
+
+				lock.unlock();
+				block_added.notify_one();
+			}
+		}
+
+		catch (const std::exception &e)
+		{
+			failure = "corrupt compressed file: " + file_path + " (" + e.what() + ")";
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(reader_mutex);
+			error = failure;
+			finished = true;
+		}
+
+		block_added.notify_all();
+	}
+}
@@ -0,0 +1,167 @@
+#include "ogl_tools.h"
+#include <algorithm>
+#include <cstring>
+
+namespace jep
+{
+	//smallest power of two table keeping count entries at most half full
+	std::size_t getTableSize(std::size_t count)
+	{
+		std::size_t size = 64;
+		while (size < count * 2)
+			size *= 2;
+
+		return size;
+	}
+
+	unsigned long long hashPosition(const glm::vec4 &position)
+	{
+		unsigned long long hash = 0;
+
+		for (int i = 0; i < 4; i++)
+		{
+			//adding 0 turns -0 into 0, they compare equal so they must hash the same
+			float value = position[i] + 0.0f;
+			unsigned int bits;
+			memcpy(&bits, &value, sizeof(bits));
+			hash = mixHash(hash, bits);
+		}
+
+		return hash;
+	}
+
+	half_edge_mesh::half_edge_mesh(const mesh_data &mesh)
+	{
+		array_view<vertex_data> vertices = mesh.getVertices();
+		const vector<unsigned int> &element_index = mesh.getElementIndex();
+		std::size_t vertex_count = vertices.size();
+		std::size_t half_edge_count = element_index.size() - element_index.size() % 3;
+
+		//each vertex is welded to the first one found at its position
+		welded.resize(vertex_count);
+		vector<unsigned int> position_table(getTableSize(vertex_count), NO_HALF_EDGE);
+		std::size_t mask = position_table.size() - 1;
+
+		for (std::size_t v = 0; v < vertex_count; v++)
+		{
+			std::size_t slot = hashPosition(vertices[v].xyzw) & mask;
+
+			while (position_table[slot] != NO_HALF_EDGE && !(vertices[position_table[slot]].xyzw == vertices[v].xyzw))
+				slot = (slot + 1) & mask;
+
+			if (position_table[slot] == NO_HALF_EDGE)
+				position_table[slot] = (unsigned int)v;
+
+			welded[v] = position_table[slot];
+		}
+
+		origins.resize(half_edge_count);
+		for (std::size_t h = 0; h < half_edge_count; h++)
+			origins[h] = welded[element_index[h]];
+
+		//edges are keyed by their ends in either order, a half-edge waits in its slot until another arrives to pair with it
+		struct edge_entry
+		{
+			unsigned long long key;
+			unsigned int waiting;
+			bool used;
+		};
+
+		twins.assign(half_edge_count, NO_HALF_EDGE);
+		vector<edge_entry> edge_table(getTableSize(half_edge_count), edge_entry{ 0, NO_HALF_EDGE, false });
+		mask = edge_table.size() - 1;
+
+		for (unsigned int h = 0; h < half_edge_count; h++)
+		{
+			unsigned long long a = origins[h];
+			unsigned long long b = getDestination(h);
+
+			if (a == b)
+				continue;
+
+			unsigned long long key = a < b ? (a << 32) | b : (b << 32) | a;
+			std::size_t slot = mixHash(0, key) & mask;
+
+			while (edge_table[slot].used && edge_table[slot].key != key)
+				slot = (slot + 1) & mask;
+
+			edge_entry &entry = edge_table[slot];
+			entry.used = true;
+			entry.key = key;
+
+			if (entry.waiting == NO_HALF_EDGE)
+				entry.waiting = h;
+
+			else
+			{
+				twins[h] = entry.waiting;
+				twins[entry.waiting] = h;
+				entry.waiting = NO_HALF_EDGE;
+			}
+		}
+
+		//half-edges leaving each vertex, as offsets into one array
+		outgoing_offset.assign(vertex_count + 1, 0);
+		for (unsigned int origin : origins)
+			outgoing_offset[origin + 1]++;
+
+		for (std::size_t v = 0; v < vertex_count; v++)
+			outgoing_offset[v + 1] += outgoing_offset[v];
+
+		outgoing.resize(half_edge_count);
+		vector<unsigned int> fill(outgoing_offset.begin(), outgoing_offset.end() - 1);
+		for (unsigned int h = 0; h < half_edge_count; h++)
+			outgoing[fill[origins[h]]++] = h;
+	}
+
+	vector<unsigned int> half_edge_mesh::getBoundaryEdges() const
+	{
+		vector<unsigned int> boundary;
+
+		for (unsigned int h = 0; h < origins.size(); h++)
+		{
+			if (twins[h] == NO_HALF_EDGE && origins[h] != getDestination(h))
+				boundary.push_back(h);
+		}
+
+		return boundary;
+	}
+
+	vector<unsigned int> half_edge_mesh::getNeighborFaces(unsigned int face) const
+	{
+		vector<unsigned int> neighbors;
+
+		for (unsigned int h = face * 3; h < face * 3 + 3 && h < origins.size(); h++)
+		{
+			if (twins[h] != NO_HALF_EDGE && std::find(neighbors.begin(), neighbors.end(), getFace(twins[h])) == neighbors.end())
+				neighbors.push_back(getFace(twins[h]));
+		}
+
+		return neighbors;
+	}
+
+	vector<unsigned int> half_edge_mesh::getVertexRing(unsigned int vertex) const
+	{
+		vector<unsigned int> ring;
+
+		if (vertex >= welded.size())
+			return ring;
+
+		vertex = welded[vertex];
+
+		//the far end of each outgoing edge, and the start of the edge coming in before it,
+		//which covers a border vertex whose incoming border edge has no outgoing twin
+		for (unsigned int i = outgoing_offset[vertex]; i < outgoing_offset[vertex + 1]; i++)
+		{
+			unsigned int h = outgoing[i];
+			ring.push_back(getDestination(h));
+			ring.push_back(origins[getPrevious(h)]);
+		}
+
+		std::sort(ring.begin(), ring.end());
+		ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+		ring.erase(std::remove(ring.begin(), ring.end(), vertex), ring.end());
+
+		return ring;
+	}
+}
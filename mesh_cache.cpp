@@ -0,0 +1,387 @@
+#include "ogl_tools.h"
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace jep
+{
+	//bump whenever the layout written by mesh_cache::save changes
+	const unsigned int MESH_CACHE_VERSION = 6;
+	const char MESH_CACHE_MAGIC[8] = { 'O', 'G', 'L', 'M', 'E', 'S', 'H', '\0' };
+
+	//64-bit multiply/rotate hash, consumes 8 bytes per step so hashing stays far cheaper than parsing
+	unsigned long long hashBytes(const char* data, std::size_t size)
+	{
+		const unsigned long long prime = 0x9E3779B97F4A7C15ULL;
+		unsigned long long hash = 0xCBF29CE484222325ULL ^ (size * prime);
+
+		std::size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			unsigned long long word;
+			memcpy(&word, data + i, 8);
+
+			hash ^= word * prime;
+			hash = (hash << 31) | (hash >> 33);
+			hash *= prime;
+		}
+
+		for (; i < size; i++)
+		{
+			hash ^= (unsigned char)data[i];
+			hash *= 0x100000001B3ULL;
+		}
+
+		hash ^= hash >> 29;
+		hash *= prime;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	template <typename T>
+	void appendValue(string &buffer, const T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "mesh cache values must be trivially copyable");
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void appendArray(string &buffer, array_view<T> values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "mesh cache values must be trivially copyable");
+		appendValue(buffer, (unsigned long long)values.size());
+
+		if (values.size() > 0)
+			buffer.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+	}
+
+	template <typename T, typename Allocator>
+	void appendArray(string &buffer, const std::vector<T, Allocator> &values)
+	{
+		appendArray(buffer, array_view<T>(values));
+	}
+
+	void appendString(string &buffer, const string &value)
+	{
+		appendValue(buffer, (unsigned long long)value.size());
+		buffer.append(value);
+	}
+
+	//every read is bounds checked, a truncated or corrupt cache fails instead of reading past the mapping
+	template <typename T>
+	bool readValue(const char* &cursor, const char* end, T &value)
+	{
+		if (std::size_t(end - cursor) < sizeof(T))
+			return false;
+
+		memcpy(&value, cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	template <typename T, typename Allocator>
+	bool readArray(const char* &cursor, const char* end, std::vector<T, Allocator> &values)
+	{
+		unsigned long long count;
+		if (!readValue(cursor, end, count))
+			return false;
+
+		if (count > std::size_t(end - cursor) / sizeof(T))
+			return false;
+
+		values.resize(std::size_t(count));
+
+		if (count > 0)
+			memcpy(values.data(), cursor, std::size_t(count) * sizeof(T));
+
+		cursor += std::size_t(count) * sizeof(T);
+		return true;
+	}
+
+	bool readString(const char* &cursor, const char* end, string &value)
+	{
+		unsigned long long length;
+		if (!readValue(cursor, end, length) || length > std::size_t(end - cursor))
+			return false;
+
+		value.assign(cursor, std::size_t(length));
+		cursor += std::size_t(length);
+		return true;
+	}
+
+	string mesh_cache::getCachePath(const char* obj_file)
+	{
+		return string(obj_file) + ".meshcache";
+	}
+
+	bool mesh_cache::getSourceKey(const char* obj_file, mesh_cache_key &key, bool hash_contents)
+	{
+	#ifdef _WIN32
+		struct _stat64 file_stats;
+		if (_stat64(obj_file, &file_stats) != 0)
+			return false;
+	#else
+		struct stat file_stats;
+		if (stat(obj_file, &file_stats) != 0)
+			return false;
+	#endif
+
+		key.source_path = obj_file;
+		key.file_size = (unsigned long long)file_stats.st_size;
+		key.modified_time = (long long)file_stats.st_mtime;
+		key.content_hash = 0;
+
+		if (!hash_contents)
+			return true;
+
+		file_mapping source(obj_file);
+		if (!source.isOpen() || source.size() != key.file_size)
+			return false;
+
+		key.content_hash = hashBytes(source.data(), source.size());
+		return true;
+	}
+
+	/*
+	cache layout, all values in native byte order:
+		magic, version, source path, source size, source mtime, source hash
+		mesh count, payload size, payload hash
+		payload (each mesh written by writeMesh)
+	*/
+	bool mesh_cache::load(const char* cache_file, const char* obj_file, vector<mesh_data> &meshes)
+	{
+		file_mapping cache(cache_file);
+		if (!cache.isOpen() || cache.size() == 0)
+			return false;
+
+		const char* cursor = cache.data();
+		const char* end = cache.data() + cache.size();
+
+		char magic[8];
+		unsigned int version;
+		if (!readValue(cursor, end, magic) || memcmp(magic, MESH_CACHE_MAGIC, 8) != 0)
+			return false;
+
+		if (!readValue(cursor, end, version) || version != MESH_CACHE_VERSION)
+			return false;
+
+		mesh_cache_key cached_key;
+		if (!readString(cursor, end, cached_key.source_path) ||
+			!readValue(cursor, end, cached_key.file_size) ||
+			!readValue(cursor, end, cached_key.modified_time) ||
+			!readValue(cursor, end, cached_key.content_hash))
+			return false;
+
+		//cheap checks first, the source is only hashed once path, size and mtime all match
+		mesh_cache_key source_key;
+		if (!getSourceKey(obj_file, source_key, false))
+			return false;
+
+		if (cached_key.source_path != source_key.source_path ||
+			cached_key.file_size != source_key.file_size ||
+			cached_key.modified_time != source_key.modified_time)
+			return false;
+
+		if (!getSourceKey(obj_file, source_key, true) || cached_key.content_hash != source_key.content_hash)
+			return false;
+
+		unsigned long long mesh_count, payload_size, payload_hash;
+		if (!readValue(cursor, end, mesh_count) ||
+			!readValue(cursor, end, payload_size) ||
+			!readValue(cursor, end, payload_hash))
+			return false;
+
+		if (payload_size != std::size_t(end - cursor) || hashBytes(cursor, std::size_t(payload_size)) != payload_hash)
+			return false;
+
+		vector<mesh_data> loaded;
+		loaded.reserve(std::size_t(mesh_count));
+
+		try
+		{
+			for (unsigned long long i = 0; i < mesh_count; i++)
+			{
+				loaded.push_back(mesh_data());
+
+				if (!readMesh(cursor, end, loaded.back()))
+					return false;
+			}
+		}
+
+		//allocation failure on a corrupt size
+		catch (...)
+		{
+			return false;
+		}
+
+		if (cursor != end)
+			return false;
+
+		meshes.swap(loaded);
+		return true;
+	}
+
+	bool mesh_cache::save(const char* cache_file, const mesh_cache_key &key, const vector<mesh_data> &meshes)
+	{
+		string payload;
+		for (const auto &mesh : meshes)
+			writeMesh(payload, mesh);
+
+		string header;
+		header.append(MESH_CACHE_MAGIC, 8);
+		appendValue(header, MESH_CACHE_VERSION);
+		appendString(header, key.source_path);
+		appendValue(header, key.file_size);
+		appendValue(header, key.modified_time);
+		appendValue(header, key.content_hash);
+		appendValue(header, (unsigned long long)meshes.size());
+		appendValue(header, (unsigned long long)payload.size());
+		appendValue(header, hashBytes(payload.data(), payload.size()));
+
+		//written beside the cache first, so a crash mid-write never leaves a half written cache in place
+		string temp_file = string(cache_file) + ".tmp";
+
+		std::ofstream file(temp_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(header.data(), header.size());
+		file.write(payload.data(), payload.size());
+		file.close();
+
+		if (file.fail())
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		std::remove(cache_file);
+		if (std::rename(temp_file.c_str(), cache_file) != 0)
+		{
+			std::remove(temp_file.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	//vertex_data is trivially copyable, so the unique vertex table is written and read back as one block
+	void mesh_cache::writeMesh(string &buffer, const mesh_data &mesh)
+	{
+		appendString(buffer, mesh.mesh_name);
+		appendString(buffer, mesh.material_name);
+
+		const int sizes[] = {
+			mesh.interleave_stride, mesh.interleave_vt_offset, mesh.interleave_vn_offset,
+			mesh.v_size, mesh.vt_size, mesh.vn_size, mesh.vp_size, mesh.tan_size, mesh.bitan_size,
+			mesh.vertex_count, mesh.total_face_count, mesh.total_float_count
+		};
+		appendValue(buffer, sizes);
+
+		appendArray(buffer, mesh.all_v_data);
+		appendArray(buffer, mesh.all_vt_data);
+		appendArray(buffer, mesh.all_vn_data);
+		appendArray(buffer, mesh.all_vp_data);
+		appendArray(buffer, mesh.element_index);
+
+		appendArray(buffer, mesh.vertices);
+		appendArray(buffer, mesh.vertex_tangents);
+		appendArray(buffer, mesh.vertex_bitangents);
+
+		appendValue(buffer, (unsigned long long)mesh.lods.size());
+		for (const mesh_lod &lod : mesh.lods)
+		{
+			appendValue(buffer, lod.error);
+			appendArray(buffer, lod.element_index);
+		}
+
+		appendArray(buffer, mesh.meshlets);
+	}
+
+	bool mesh_cache::readMesh(const char* &cursor, const char* end, mesh_data &mesh)
+	{
+		if (!readString(cursor, end, mesh.mesh_name) || !readString(cursor, end, mesh.material_name))
+			return false;
+
+		int sizes[12];
+		if (!readValue(cursor, end, sizes))
+			return false;
+
+		mesh.interleave_stride = sizes[0];
+		mesh.interleave_vt_offset = sizes[1];
+		mesh.interleave_vn_offset = sizes[2];
+		mesh.v_size = sizes[3];
+		mesh.vt_size = sizes[4];
+		mesh.vn_size = sizes[5];
+		mesh.vp_size = sizes[6];
+		mesh.tan_size = sizes[7];
+		mesh.bitan_size = sizes[8];
+		mesh.vertex_count = sizes[9];
+		mesh.total_face_count = sizes[10];
+		mesh.total_float_count = sizes[11];
+
+		if (!readArray(cursor, end, mesh.all_v_data) ||
+			!readArray(cursor, end, mesh.all_vt_data) ||
+			!readArray(cursor, end, mesh.all_vn_data) ||
+			!readArray(cursor, end, mesh.all_vp_data) ||
+			!readArray(cursor, end, mesh.element_index) ||
+			!readArray(cursor, end, mesh.vertices) ||
+			!readArray(cursor, end, mesh.vertex_tangents) ||
+			!readArray(cursor, end, mesh.vertex_bitangents))
+			return false;
+
+		//tangent frames are either all there or not generated at all
+		if (mesh.vertex_bitangents.size() != mesh.vertex_tangents.size() ||
+			(!mesh.vertex_tangents.empty() && mesh.vertex_tangents.size() != mesh.vertices.size()) ||
+			mesh.element_index.size() % 3 != 0)
+			return false;
+
+		const unsigned char known_attributes = vertex_data::HAS_W | vertex_data::HAS_UV | vertex_data::HAS_NORMAL;
+		for (const vertex_data &vertex : mesh.vertices)
+		{
+			if (vertex.attributes & ~known_attributes)
+				return false;
+		}
+
+		unsigned long long lod_count;
+		if (!readValue(cursor, end, lod_count) || lod_count > std::size_t(end - cursor))
+			return false;
+
+		mesh.lods.resize(std::size_t(lod_count));
+		for (mesh_lod &lod : mesh.lods)
+		{
+			if (!readValue(cursor, end, lod.error) || !readArray(cursor, end, lod.element_index) || lod.element_index.size() % 3 != 0)
+				return false;
+		}
+
+		if (!readArray(cursor, end, mesh.meshlets))
+			return false;
+
+		for (const meshlet &cluster : mesh.meshlets)
+		{
+			if (cluster.index_count % 3 != 0 || cluster.first_index > mesh.element_index.size() ||
+				cluster.index_count > mesh.element_index.size() - cluster.first_index)
+				return false;
+		}
+
+		for (unsigned int index : mesh.element_index)
+		{
+			if (index >= mesh.vertices.size())
+				return false;
+		}
+
+		for (const mesh_lod &lod : mesh.lods)
+		{
+			for (unsigned int index : lod.element_index)
+			{
+				if (index >= mesh.vertices.size())
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,101 @@
+#include "ogl_tools.h"
+
+namespace jep
+{
+	mesh_loader::mesh_loader(const char* obj_file) :
+		obj_file(obj_file), bytes_parsed(0), bytes_total(0), meshes_built(0), faces_built(0),
+		finished(false), cancelled(false)
+	{
+		done = result.get_future().share();
+		worker = std::thread(&mesh_loader::load, this);
+	}
+
+	mesh_loader::~mesh_loader()
+	{
+		cancelled = true;
+
+		if (worker.joinable())
+			worker.join();
+	}
+
+	load_progress mesh_loader::getProgress() const
+	{
+		load_progress progress;
+		progress.bytes_parsed = bytes_parsed;
+		progress.bytes_total = bytes_total;
+		progress.meshes_built = meshes_built;
+		progress.faces_built = faces_built;
+		progress.finished = finished;
+		return progress;
+	}
+
+	vector<mesh_data> mesh_loader::takeFinishedMeshes()
+	{
+		vector<mesh_data> taken;
+
+		std::lock_guard<std::mutex> lock(loader_mutex);
+		taken.swap(finished_meshes);
+
+		return taken;
+	}
+
+	const string mesh_loader::getMTLFilename() const
+	{
+		std::lock_guard<std::mutex> lock(loader_mutex);
+		return mtl_filename;
+	}
+
+	vector<string> mesh_loader::getErrors() const
+	{
+		std::lock_guard<std::mutex> lock(loader_mutex);
+		return error_log;
+	}
+
+	void mesh_loader::addMesh(mesh_data &mesh)
+	{
+		faces_built += mesh.getFaceCount();
+
+		{
+			std::lock_guard<std::mutex> lock(loader_mutex);
+			finished_meshes.push_back(std::move(mesh));
+		}
+
+		meshes_built++;
+	}
+
+	//runs on the background thread
+	void mesh_loader::load()
+	{
+		bool opened = false;
+
+		try
+		{
+			obj_contents contents(obj_file.c_str(),
+				[this](mesh_data &mesh) { addMesh(mesh); },
+				[this, &opened](std::size_t parsed, std::size_t total) {
+					opened = true;
+					bytes_parsed = parsed;
+					bytes_total = total;
+					return !cancelled;
+				});
+
+			std::lock_guard<std::mutex> lock(loader_mutex);
+			mtl_filename = contents.getMTLFilename();
+			error_log = contents.getErrors();
+		}
+
+		catch (const std::exception &e)
+		{
+			string error = "unable to load obj file: ";
+			error += obj_file + " (" + e.what() + ")";
+			std::cout << error << std::endl;
+
+			std::lock_guard<std::mutex> lock(loader_mutex);
+			error_log.push_back(error);
+			opened = false;
+		}
+
+		finished = true;
+		result.set_value(opened && !cancelled);
+	}
+}
@@ -0,0 +1,373 @@
+#include "ogl_tools.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+namespace jep
+{
+	//symmetric 4x4 matrix summing squared distances to a set of planes (Garland and Heckbert 1997), weighted by area
+	struct plane_quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+	};
+
+	void addPlane(plane_quadric &q, double a, double b, double c, double d, double weight)
+	{
+		q.a2 += weight * a * a; q.ab += weight * a * b; q.ac += weight * a * c; q.ad += weight * a * d;
+		q.b2 += weight * b * b; q.bc += weight * b * c; q.bd += weight * b * d;
+		q.c2 += weight * c * c; q.cd += weight * c * d;
+		q.d2 += weight * d * d;
+		q.weight += weight;
+	}
+
+	void addQuadric(plane_quadric &q, const plane_quadric &other)
+	{
+		q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+		q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+		q.c2 += other.c2; q.cd += other.cd;
+		q.d2 += other.d2;
+		q.weight += other.weight;
+	}
+
+	//mean squared distance from p to the quadric's planes
+	double evaluateQuadric(const plane_quadric &q, const glm::vec3 &p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error =
+			q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x +
+			q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y +
+			q.c2 * z * z + 2.0 * q.cd * z +
+			q.d2;
+
+		return q.weight > 0.0 ? std::fabs(error) / q.weight : 0.0;
+	}
+
+	struct edge_collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double cost;
+	};
+
+	vector<unsigned int> simplifyIndices(array_view<vertex_data> vertices, array_view<unsigned int> indices,
+		std::size_t target_index_count, float* error)
+	{
+		std::size_t vertex_count = vertices.size();
+		vector<glm::vec3> positions(vertex_count);
+		for (std::size_t v = 0; v < vertex_count; v++)
+			positions[v] = glm::vec3(vertices[v].xyzw);
+
+		//vertices differing only in uv or normal share a position, they are welded so seams are seen as one surface
+		vector<unsigned int> by_position(vertex_count);
+		for (std::size_t v = 0; v < vertex_count; v++)
+			by_position[v] = (unsigned int)v;
+
+		std::sort(by_position.begin(), by_position.end(), [&positions](unsigned int a, unsigned int b) {
+			const glm::vec3 &pa = positions[a];
+			const glm::vec3 &pb = positions[b];
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		});
+
+		//vertices sharing a position form a group, by_position[group_begin[g], group_end[g]) for the first vertex g of each
+		//groups are collapsed as a whole, so normal splits and hard edges simplify like any other vertex
+		vector<unsigned int> weld(vertex_count);
+		vector<unsigned int> group_begin(vertex_count, 0), group_end(vertex_count, 0);
+		//uv seams and open borders are never moved, so textures don't tear and holes don't grow, indexed by group
+		vector<char> locked(vertex_count, 0);
+
+		for (std::size_t i = 0; i < vertex_count; )
+		{
+			std::size_t j = i + 1;
+			while (j < vertex_count && positions[by_position[j]] == positions[by_position[i]])
+				j++;
+
+			unsigned int group = by_position[i];
+			group_begin[group] = (unsigned int)i;
+			group_end[group] = (unsigned int)j;
+
+			for (std::size_t k = i; k < j; k++)
+			{
+				const vertex_data &first = vertices[group];
+				const vertex_data &member = vertices[by_position[k]];
+				weld[by_position[k]] = group;
+
+				if ((member.attributes & vertex_data::HAS_UV) != (first.attributes & vertex_data::HAS_UV) || !(member.uv == first.uv))
+					locked[group] = 1;
+			}
+
+			i = j;
+		}
+
+		std::unordered_set<unsigned long long> directed_edges;
+		for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned long long a = weld[indices[i + e]];
+				unsigned long long b = weld[indices[i + (e + 1) % 3]];
+				directed_edges.insert((a << 32) | b);
+			}
+		}
+
+		for (unsigned long long edge : directed_edges)
+		{
+			unsigned long long a = edge >> 32;
+			unsigned long long b = edge & 0xFFFFFFFFULL;
+
+			if (directed_edges.count((b << 32) | a) == 0)
+			{
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+
+		//quadrics are kept per welded position
+		vector<plane_quadric> quadrics(vertex_count, plane_quadric{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 });
+		for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const glm::vec3 &p0 = positions[indices[i]];
+			glm::vec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+			float double_area = glm::length(normal);
+
+			if (double_area <= 0.0f)
+				continue;
+
+			normal = normal / double_area;
+			double d = -glm::dot(normal, p0);
+
+			for (int corner = 0; corner < 3; corner++)
+				addPlane(quadrics[weld[indices[i + corner]]], normal.x, normal.y, normal.z, d, double_area * 0.5);
+		}
+
+		vector<unsigned int> result(indices.begin(), indices.end());
+		target_index_count -= target_index_count % 3;
+		double max_cost = 0.0;
+
+		vector<unsigned int> remap(vertex_count);
+		vector<char> touched(vertex_count);
+		vector<unsigned int> adjacency_offset(vertex_count + 1);
+		vector<unsigned int> adjacency;
+		vector<edge_collapse> collapses;
+		//(member of the from group, vertex of the to group) sharing a triangle
+		vector< std::pair<unsigned int, unsigned int> > targets;
+
+		while (result.size() > target_index_count)
+		{
+			std::size_t triangle_count = result.size() / 3;
+
+			//triangles around each vertex, for the flip test
+			std::fill(adjacency_offset.begin(), adjacency_offset.end(), 0);
+			for (unsigned int v : result)
+				adjacency_offset[v + 1]++;
+
+			for (std::size_t v = 0; v < vertex_count; v++)
+				adjacency_offset[v + 1] += adjacency_offset[v];
+
+			adjacency.resize(result.size());
+			vector<unsigned int> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+			for (std::size_t i = 0; i < result.size(); i++)
+				adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+			//every edge between groups, in both directions where the group moved is free to move, cheapest first
+			collapses.clear();
+			for (std::size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					unsigned int a = weld[result[i + e]];
+					unsigned int b = weld[result[i + (e + 1) % 3]];
+					unsigned int ends[2][2] = { { a, b }, { b, a } };
+
+					if (a == b)
+						continue;
+
+					for (const auto &end : ends)
+					{
+						if (locked[end[0]])
+							continue;
+
+						plane_quadric combined = quadrics[end[0]];
+						addQuadric(combined, quadrics[end[1]]);
+						collapses.push_back(edge_collapse{ end[0], end[1], evaluateQuadric(combined, positions[end[1]]) });
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const edge_collapse &a, const edge_collapse &b) { return a.cost < b.cost; });
+
+			for (std::size_t v = 0; v < vertex_count; v++)
+				remap[v] = (unsigned int)v;
+
+			std::fill(touched.begin(), touched.end(), 0);
+
+			//each collapse removes the triangles on its edge, stop once enough are gone
+			std::size_t removable = triangle_count - target_index_count / 3;
+			std::size_t removed = 0;
+			int collapse_count = 0;
+
+			for (const edge_collapse &collapse : collapses)
+			{
+				if (removed >= removable)
+					break;
+
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				//moving the from group onto the to group must not turn any remaining triangle around from over
+				bool flips = false;
+				std::size_t shared = 0;
+				targets.clear();
+
+				for (unsigned int m = group_begin[collapse.from]; m < group_end[collapse.from] && !flips; m++)
+				{
+					unsigned int member = by_position[m];
+
+					for (unsigned int a = adjacency_offset[member]; a < adjacency_offset[member + 1] && !flips; a++)
+					{
+						const unsigned int* corners = &result[adjacency[a] * 3];
+						bool on_edge = false;
+
+						for (int corner = 0; corner < 3; corner++)
+						{
+							if (weld[corners[corner]] == collapse.to)
+							{
+								on_edge = true;
+								targets.push_back(std::make_pair(member, corners[corner]));
+							}
+						}
+
+						if (on_edge)
+						{
+							shared++;
+							continue;
+						}
+
+						glm::vec3 before[3], after[3];
+						for (int corner = 0; corner < 3; corner++)
+						{
+							before[corner] = positions[corners[corner]];
+							after[corner] = weld[corners[corner]] == collapse.from ? positions[collapse.to] : before[corner];
+						}
+
+						glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+						glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+						if (glm::dot(normal_before, normal_after) <= 0.0f)
+							flips = true;
+					}
+				}
+
+				if (flips || targets.empty())
+					continue;
+
+				//a member moves onto the vertex it shares an edge with, one on a side of a normal split away from the edge
+				//takes the target whose normal is closest to its own, the group's uvs agree so only normals differ
+				for (unsigned int m = group_begin[collapse.from]; m < group_end[collapse.from]; m++)
+				{
+					unsigned int member = by_position[m];
+					unsigned int target = targets[0].second;
+					float closest = -2.0f;
+
+					for (const std::pair<unsigned int, unsigned int> &candidate : targets)
+					{
+						if (candidate.first == member)
+						{
+							target = candidate.second;
+							break;
+						}
+
+						float similarity = glm::dot(vertices[member].n_xyz, vertices[candidate.second].n_xyz);
+						if (similarity > closest)
+						{
+							closest = similarity;
+							target = candidate.second;
+						}
+					}
+
+					remap[member] = target;
+				}
+
+				addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+				max_cost = std::max(max_cost, collapse.cost);
+				removed += shared;
+				collapse_count++;
+
+				//every group sharing a triangle with from is left alone until the next pass rebuilds adjacency
+				for (unsigned int m = group_begin[collapse.from]; m < group_end[collapse.from]; m++)
+				{
+					unsigned int member = by_position[m];
+
+					for (unsigned int a = adjacency_offset[member]; a < adjacency_offset[member + 1]; a++)
+					{
+						const unsigned int* corners = &result[adjacency[a] * 3];
+						touched[weld[corners[0]]] = 1;
+						touched[weld[corners[1]]] = 1;
+						touched[weld[corners[2]]] = 1;
+					}
+				}
+			}
+
+			if (collapse_count == 0)
+				break;
+
+			//triangles that lost an edge (or whose corners now share a position) are dropped
+			std::size_t kept = 0;
+			for (std::size_t i = 0; i < result.size(); i += 3)
+			{
+				unsigned int a = remap[result[i]];
+				unsigned int b = remap[result[i + 1]];
+				unsigned int c = remap[result[i + 2]];
+
+				if (weld[a] == weld[b] || weld[b] == weld[c] || weld[c] == weld[a])
+					continue;
+
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+
+			result.resize(kept);
+		}
+
+		if (error != nullptr)
+			*error = float(std::sqrt(max_cost));
+
+		return result;
+	}
+
+	vector<unsigned int> mesh_data::simplify(std::size_t target_index_count, float* error) const
+	{
+		return simplifyIndices(vertices, element_index, target_index_count, error);
+	}
+
+	void mesh_data::buildLODChain(int max_levels, float reduction)
+	{
+		lods.clear();
+
+		std::size_t previous_count = element_index.size();
+		float previous_error = 0.0f;
+		double target = double(element_index.size());
+
+		for (int level = 0; level < max_levels; level++)
+		{
+			//each level is simplified from the full mesh, not the level before it, so errors don't compound
+			target *= reduction;
+
+			mesh_lod lod;
+			lod.element_index = simplify(std::size_t(target), &lod.error);
+
+			//a level that barely shrinks isn't worth its memory, and later ones won't do better
+			if (lod.element_index.empty() || lod.element_index.size() > previous_count * 9 / 10)
+				break;
+
+			lod.error = std::max(lod.error, previous_error);
+			previous_count = lod.element_index.size();
+			previous_error = lod.error;
+			lods.push_back(std::move(lod));
+		}
+	}
+}
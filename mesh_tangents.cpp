@@ -0,0 +1,149 @@
+#include "ogl_tools.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace jep
+{
+	//faces per task, smaller meshes aren't worth handing to other threads
+	const std::size_t TANGENT_TASK_FACES = 1 << 14;
+
+	//tangent (along u) and bitangent (along v) of a triangle, scaled by its position to uv area ratio
+	//missing uvs fall back to a fixed unit triangle, false when the uvs don't span an area
+	bool calcFaceTangents(const vertex_data &v_data_0, const vertex_data &v_data_1, const vertex_data &v_data_2,
+		glm::vec3 &tangent, glm::vec3 &bitangent)
+	{
+		glm::vec3 v0(v_data_0.xyzw);
+		glm::vec3 v1(v_data_1.xyzw);
+		glm::vec3 v2(v_data_2.xyzw);
+
+		glm::vec2 uv0 = (v_data_0.attributes & vertex_data::HAS_UV) ? v_data_0.uv : glm::vec2(0.0f, 0.0f);
+		glm::vec2 uv1 = (v_data_1.attributes & vertex_data::HAS_UV) ? v_data_1.uv : glm::vec2(1.0f, 1.0f);
+		glm::vec2 uv2 = (v_data_2.attributes & vertex_data::HAS_UV) ? v_data_2.uv : glm::vec2(1.0f, 0.0f);
+
+		glm::vec3 deltaPos1 = v1 - v0;
+		glm::vec3 deltaPos2 = v2 - v0;
+
+		glm::vec2 deltaUV1 = uv1 - uv0;
+		glm::vec2 deltaUV2 = uv2 - uv0;
+
+		float determinant = deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x;
+		float r = 1.0f / determinant;
+
+		tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
+		bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
+
+		return determinant != 0.0f && std::isfinite(r);
+	}
+
+	vector<glm::vec3> mesh_data::calcTangentBitangent(array_view<vertex_data> face_data)
+	{
+		glm::vec3 tangent, bitangent;
+		calcFaceTangents(face_data[0], face_data[1], face_data[2], tangent, bitangent);
+
+		return vector<glm::vec3> {tangent, bitangent};
+	}
+
+	//any unit vector perpendicular to normal, for vertices whose faces give no usable tangent
+	glm::vec3 getPerpendicular(const glm::vec3 &normal)
+	{
+		glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		return glm::normalize(glm::cross(normal, axis));
+	}
+
+	void mesh_data::generateTangents(int thread_count)
+	{
+		if (thread_count < 1)
+			thread_count = std::max(1, int(std::thread::hardware_concurrency()));
+
+		std::size_t face_count = element_index.size() / 3;
+		std::size_t vertex_total = vertices.size();
+
+		//tasks split faces, then vertices, into contiguous ranges
+		int task_count = int(std::max<std::size_t>(1, std::min<std::size_t>(std::size_t(thread_count) * 4,
+			(face_count + TANGENT_TASK_FACES - 1) / TANGENT_TASK_FACES)));
+
+		auto taskRange = [task_count](std::size_t total, int task, std::size_t &first, std::size_t &last) {
+			first = total * task / task_count;
+			last = total * (task + 1) / task_count;
+		};
+
+		//each face on its own, faces with degenerate uvs contribute only their normal
+		vector<glm::vec3> face_tangents(face_count);
+		vector<glm::vec3> face_bitangents(face_count);
+		vector<glm::vec3> face_normals(face_count);
+
+		runParallel(thread_count, task_count, [&](int task) {
+			std::size_t first, last;
+			taskRange(face_count, task, first, last);
+
+			for (std::size_t face = first; face < last; face++)
+			{
+				const vertex_data &a = vertices[element_index[face * 3]];
+				const vertex_data &b = vertices[element_index[face * 3 + 1]];
+				const vertex_data &c = vertices[element_index[face * 3 + 2]];
+
+				if (!calcFaceTangents(a, b, c, face_tangents[face], face_bitangents[face]))
+				{
+					face_tangents[face] = glm::vec3(0.0f);
+					face_bitangents[face] = glm::vec3(0.0f);
+				}
+
+				//area weighted, only used where the vertex has no normal of its own
+				face_normals[face] = glm::cross(glm::vec3(b.xyzw) - glm::vec3(a.xyzw), glm::vec3(c.xyzw) - glm::vec3(a.xyzw));
+			}
+		});
+
+		//faces around each vertex, as offsets into one array, so every vertex sums its own faces and no thread shares a sum
+		vector<unsigned int> adjacency_offset(vertex_total + 1, 0);
+		for (std::size_t i = 0; i < face_count * 3; i++)
+			adjacency_offset[element_index[i] + 1]++;
+
+		for (std::size_t v = 0; v < vertex_total; v++)
+			adjacency_offset[v + 1] += adjacency_offset[v];
+
+		vector<unsigned int> adjacency(face_count * 3);
+		vector<unsigned int> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (std::size_t i = 0; i < face_count * 3; i++)
+			adjacency[fill[element_index[i]]++] = (unsigned int)(i / 3);
+
+		vertex_tangents.assign(vertex_total, glm::vec4(0.0f));
+		vertex_bitangents.assign(vertex_total, glm::vec3(0.0f));
+
+		runParallel(thread_count, task_count, [&](int task) {
+			std::size_t first, last;
+			taskRange(vertex_total, task, first, last);
+
+			for (std::size_t v = first; v < last; v++)
+			{
+				glm::vec3 tangent(0.0f), bitangent(0.0f), face_normal(0.0f);
+
+				for (unsigned int a = adjacency_offset[v]; a < adjacency_offset[v + 1]; a++)
+				{
+					tangent += face_tangents[adjacency[a]];
+					bitangent += face_bitangents[adjacency[a]];
+					face_normal += face_normals[adjacency[a]];
+				}
+
+				const vertex_data &vertex = vertices[v];
+				glm::vec3 normal = (vertex.attributes & vertex_data::HAS_NORMAL) ? vertex.n_xyz : face_normal;
+
+				if (glm::length(normal) > 0.0f)
+					normal = glm::normalize(normal);
+
+				else normal = glm::vec3(0.0f, 0.0f, 1.0f);
+
+				//gram-schmidt, the tangent loses whatever part of it runs along the normal
+				tangent -= normal * glm::dot(normal, tangent);
+				float tangent_length = glm::length(tangent);
+				tangent = tangent_length > 0.0f ? tangent / tangent_length : getPerpendicular(normal);
+
+				//uvs mirrored across the vertex flip the frame, which the bitangent's side of the normal records
+				float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+
+				vertex_tangents[v] = glm::vec4(tangent, handedness);
+				vertex_bitangents[v] = glm::cross(normal, tangent) * handedness;
+			}
+		});
+	}
+}
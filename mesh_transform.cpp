@@ -0,0 +1,273 @@
+#include "ogl_tools.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MESH_TRANSFORM_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace jep
+{
+	//normal components this close to 0 are snapped to it, so axis aligned normals stay exact after a rotation
+	const float NORMAL_SNAP_EPSILON = 0.0001f;
+
+	//the vertex table split into one array per component, so a whole register of vertices is transformed at once
+	struct vertex_soa
+	{
+		vector<float> x, y, z, w;
+		vector<float> nx, ny, nz;
+	};
+
+	//out = m * (x, y, z, w) for count points, in place
+	void transformPositions(const glm::mat4 &m, float* x, float* y, float* z, float* w, std::size_t count)
+	{
+		std::size_t i = 0;
+
+	#if defined(__AVX__)
+		__m256 c[4][4];
+		for (int column = 0; column < 4; column++)
+			for (int row = 0; row < 4; row++)
+				c[column][row] = _mm256_set1_ps(m[column][row]);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 in[4] = { _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i), _mm256_loadu_ps(w + i) };
+			__m256 out[4];
+
+			for (int row = 0; row < 4; row++)
+			{
+				out[row] = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(c[0][row], in[0]), _mm256_mul_ps(c[1][row], in[1])),
+					_mm256_add_ps(_mm256_mul_ps(c[2][row], in[2]), _mm256_mul_ps(c[3][row], in[3])));
+			}
+
+			_mm256_storeu_ps(x + i, out[0]);
+			_mm256_storeu_ps(y + i, out[1]);
+			_mm256_storeu_ps(z + i, out[2]);
+			_mm256_storeu_ps(w + i, out[3]);
+		}
+	#elif defined(MESH_TRANSFORM_SSE)
+		__m128 c[4][4];
+		for (int column = 0; column < 4; column++)
+			for (int row = 0; row < 4; row++)
+				c[column][row] = _mm_set1_ps(m[column][row]);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 in[4] = { _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i), _mm_loadu_ps(w + i) };
+			__m128 out[4];
+
+			for (int row = 0; row < 4; row++)
+			{
+				out[row] = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(c[0][row], in[0]), _mm_mul_ps(c[1][row], in[1])),
+					_mm_add_ps(_mm_mul_ps(c[2][row], in[2]), _mm_mul_ps(c[3][row], in[3])));
+			}
+
+			_mm_storeu_ps(x + i, out[0]);
+			_mm_storeu_ps(y + i, out[1]);
+			_mm_storeu_ps(z + i, out[2]);
+			_mm_storeu_ps(w + i, out[3]);
+		}
+	#endif
+
+		//whatever is left over, or everything without simd
+		for (; i < count; i++)
+		{
+			float in[4] = { x[i], y[i], z[i], w[i] };
+			float out[4];
+
+			for (int row = 0; row < 4; row++)
+				out[row] = (m[0][row] * in[0] + m[1][row] * in[1]) + (m[2][row] * in[2] + m[3][row] * in[3]);
+
+			x[i] = out[0];
+			y[i] = out[1];
+			z[i] = out[2];
+			w[i] = out[3];
+		}
+	}
+
+	//out = m * (x, y, z) for count normals, in place, components near 0 snapped to it
+	void transformNormals(const glm::mat3 &m, float* x, float* y, float* z, std::size_t count)
+	{
+		std::size_t i = 0;
+
+	#if defined(__AVX__)
+		__m256 c[3][3];
+		for (int column = 0; column < 3; column++)
+			for (int row = 0; row < 3; row++)
+				c[column][row] = _mm256_set1_ps(m[column][row]);
+
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		const __m256 epsilon = _mm256_set1_ps(NORMAL_SNAP_EPSILON);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 in[3] = { _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i) };
+			__m256 out[3];
+
+			for (int row = 0; row < 3; row++)
+			{
+				out[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0][row], in[0]), _mm256_mul_ps(c[1][row], in[1])), _mm256_mul_ps(c[2][row], in[2]));
+				out[row] = _mm256_and_ps(out[row], _mm256_cmp_ps(_mm256_andnot_ps(sign, out[row]), epsilon, _CMP_NLT_UQ));
+			}
+
+			_mm256_storeu_ps(x + i, out[0]);
+			_mm256_storeu_ps(y + i, out[1]);
+			_mm256_storeu_ps(z + i, out[2]);
+		}
+	#elif defined(MESH_TRANSFORM_SSE)
+		__m128 c[3][3];
+		for (int column = 0; column < 3; column++)
+			for (int row = 0; row < 3; row++)
+				c[column][row] = _mm_set1_ps(m[column][row]);
+
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 epsilon = _mm_set1_ps(NORMAL_SNAP_EPSILON);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 in[3] = { _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), _mm_loadu_ps(z + i) };
+			__m128 out[3];
+
+			for (int row = 0; row < 3; row++)
+			{
+				out[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0][row], in[0]), _mm_mul_ps(c[1][row], in[1])), _mm_mul_ps(c[2][row], in[2]));
+				out[row] = _mm_and_ps(out[row], _mm_cmpnlt_ps(_mm_andnot_ps(sign, out[row]), epsilon));
+			}
+
+			_mm_storeu_ps(x + i, out[0]);
+			_mm_storeu_ps(y + i, out[1]);
+			_mm_storeu_ps(z + i, out[2]);
+		}
+	#endif
+
+		for (; i < count; i++)
+		{
+			float in[3] = { x[i], y[i], z[i] };
+			float out[3];
+
+			for (int row = 0; row < 3; row++)
+			{
+				out[row] = (m[0][row] * in[0] + m[1][row] * in[1]) + m[2][row] * in[2];
+
+				if (std::fabs(out[row]) < NORMAL_SNAP_EPSILON)
+					out[row] = 0.0f;
+			}
+
+			x[i] = out[0];
+			y[i] = out[1];
+			z[i] = out[2];
+		}
+	}
+
+	//the inverse transpose keeps normals perpendicular to their faces under non-uniform scaling, and ignores translation
+	glm::mat3 getNormalMatrix(const glm::mat4 &transform)
+	{
+		return glm::transpose(glm::inverse(glm::mat3(transform)));
+	}
+
+	//gathers the vertex table into soa, transforms it, and scatters it back, normals are only touched when normal_matrix is given
+	void transformVertices(std::pmr::vector<vertex_data> &vertices, const glm::mat4 &transform, const glm::mat3* normal_matrix)
+	{
+		std::size_t count = vertices.size();
+		vertex_soa soa;
+
+		soa.x.resize(count);
+		soa.y.resize(count);
+		soa.z.resize(count);
+		soa.w.resize(count);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			soa.x[i] = vertices[i].xyzw.x;
+			soa.y[i] = vertices[i].xyzw.y;
+			soa.z[i] = vertices[i].xyzw.z;
+			soa.w[i] = vertices[i].xyzw.w;
+		}
+
+		transformPositions(transform, soa.x.data(), soa.y.data(), soa.z.data(), soa.w.data(), count);
+
+		if (normal_matrix != nullptr)
+		{
+			soa.nx.resize(count);
+			soa.ny.resize(count);
+			soa.nz.resize(count);
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				soa.nx[i] = vertices[i].n_xyz.x;
+				soa.ny[i] = vertices[i].n_xyz.y;
+				soa.nz[i] = vertices[i].n_xyz.z;
+			}
+
+			transformNormals(*normal_matrix, soa.nx.data(), soa.ny.data(), soa.nz.data(), count);
+		}
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			vertex_data &vertex = vertices[i];
+
+			//a vertex without w always reads back as w = 1
+			vertex.xyzw = glm::vec4(soa.x[i], soa.y[i], soa.z[i], (vertex.attributes & vertex_data::HAS_W) ? soa.w[i] : 1.0f);
+
+			if (normal_matrix != nullptr && (vertex.attributes & vertex_data::HAS_NORMAL))
+				vertex.n_xyz = glm::vec3(soa.nx[i], soa.ny[i], soa.nz[i]);
+		}
+	}
+
+	void mesh_data::modifyPosition(const glm::mat4 &translation_matrix)
+	{
+		transformVertices(vertices, translation_matrix, nullptr);
+
+		all_v_data.clear();
+		all_v_data.reserve(element_index.size() * v_size);
+
+		for (unsigned int index : element_index)
+			addVData(vertices[index].getVData());
+
+		vertex_index.clear();
+		updateMeshletBounds();
+	}
+
+	void mesh_data::rotate(const glm::mat4 &rotation_matrix)
+	{
+		glm::mat3 normal_matrix = getNormalMatrix(rotation_matrix);
+		transformVertices(vertices, rotation_matrix, &normal_matrix);
+
+		//tangent frames lie in the surface, so they follow the matrix itself, and a mirroring one flips their handedness
+		glm::mat3 surface_matrix(rotation_matrix);
+		float mirrored = glm::determinant(surface_matrix) < 0.0f ? -1.0f : 1.0f;
+
+		for (std::size_t i = 0; i < vertex_tangents.size(); i++)
+		{
+			glm::vec3 tangent = surface_matrix * glm::vec3(vertex_tangents[i]);
+			glm::vec3 bitangent = surface_matrix * vertex_bitangents[i];
+
+			if (glm::length(tangent) > 0.0f)
+				tangent = glm::normalize(tangent);
+
+			if (glm::length(bitangent) > 0.0f)
+				bitangent = glm::normalize(bitangent);
+
+			vertex_tangents[i] = glm::vec4(tangent, vertex_tangents[i].w * mirrored);
+			vertex_bitangents[i] = bitangent;
+		}
+
+		all_v_data.clear();
+		all_vn_data.clear();
+		all_v_data.reserve(element_index.size() * v_size);
+		all_vn_data.reserve(element_index.size() * vn_size);
+
+		for (unsigned int index : element_index)
+		{
+			addVData(vertices[index].getVData());
+			addVNData(vertices[index].getVNData());
+		}
+
+		vertex_index.clear();
+		updateMeshletBounds();
+	}
+}
@@ -0,0 +1,192 @@
+#include "ogl_tools.h"
+#include <algorithm>
+#include <cmath>
+
+namespace jep
+{
+	//a cone this wide can face the camera from almost anywhere, so it is never back-face culled
+	const float MESHLET_CONE_MIN_DOT = 0.1f;
+
+	void mesh_data::buildMeshlets(int max_vertices, int max_triangles)
+	{
+		meshlets.clear();
+
+		std::size_t triangle_count = element_index.size() / 3;
+		std::size_t vertex_total = vertices.size();
+
+		if (triangle_count == 0 || max_vertices < 3 || max_triangles < 1)
+			return;
+
+		//triangles around each vertex, as offsets into one array
+		vector<unsigned int> adjacency_offset(vertex_total + 1, 0);
+		for (unsigned int index : element_index)
+			adjacency_offset[index + 1]++;
+
+		for (std::size_t v = 0; v < vertex_total; v++)
+			adjacency_offset[v + 1] += adjacency_offset[v];
+
+		vector<unsigned int> adjacency(element_index.size());
+		vector<unsigned int> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (std::size_t i = 0; i < element_index.size(); i++)
+			adjacency[fill[element_index[i]]++] = (unsigned int)(i / 3);
+
+		//a vertex belongs to the open meshlet when its stamp matches the meshlet's
+		vector<unsigned int> vertex_stamp(vertex_total, 0);
+		unsigned int stamp = 1;
+
+		auto newVertexCount = [&](std::size_t triangle) {
+			const unsigned int* corners = &element_index[triangle * 3];
+			int count = 0;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+				if (vertex_stamp[corners[corner]] != stamp && !repeated)
+					count++;
+			}
+
+			return count;
+		};
+
+		vector<char> used(triangle_count, 0);
+		vector<unsigned int> reordered;
+		reordered.reserve(element_index.size());
+
+		meshlet current = {};
+		std::size_t cursor = 0;
+		long long last = -1;
+
+		for (;;)
+		{
+			//grow from the triangle just added, preferring neighbours that bring the fewest new vertices
+			long long next = -1;
+			int next_new = 4;
+
+			if (last != -1)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					unsigned int v = element_index[last * 3 + corner];
+
+					for (unsigned int a = adjacency_offset[v]; a < adjacency_offset[v + 1]; a++)
+					{
+						unsigned int triangle = adjacency[a];
+						if (used[triangle])
+							continue;
+
+						int added = newVertexCount(triangle);
+						if (added < next_new)
+						{
+							next = triangle;
+							next_new = added;
+						}
+					}
+				}
+			}
+
+			//nothing connected is left, continue from the next unused triangle in order
+			if (next == -1)
+			{
+				while (cursor < triangle_count && used[cursor])
+					cursor++;
+
+				if (cursor == triangle_count)
+					break;
+
+				next = cursor;
+				next_new = newVertexCount(cursor);
+			}
+
+			if (current.index_count / 3 == (unsigned int)max_triangles || int(current.vertex_count) + next_new > max_vertices)
+			{
+				meshlets.push_back(current);
+
+				current = meshlet{};
+				current.first_index = reordered.size();
+				stamp++;
+				next_new = newVertexCount(next);
+			}
+
+			used[next] = 1;
+			last = next;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int v = element_index[next * 3 + corner];
+				if (vertex_stamp[v] != stamp)
+				{
+					vertex_stamp[v] = stamp;
+					current.vertex_count++;
+				}
+
+				reordered.push_back(v);
+			}
+
+			current.index_count += 3;
+		}
+
+		if (current.index_count > 0)
+			meshlets.push_back(current);
+
+		element_index.swap(reordered);
+		updateMeshletBounds();
+	}
+
+	void mesh_data::updateMeshletBounds()
+	{
+		for (meshlet &cluster : meshlets)
+		{
+			const unsigned int* indices = &element_index[cluster.first_index];
+
+			glm::vec3 bounds_min(vertices[indices[0]].xyzw);
+			glm::vec3 bounds_max = bounds_min;
+
+			for (unsigned int i = 1; i < cluster.index_count; i++)
+			{
+				glm::vec3 position(vertices[indices[i]].xyzw);
+				bounds_min = glm::min(bounds_min, position);
+				bounds_max = glm::max(bounds_max, position);
+			}
+
+			cluster.center = (bounds_min + bounds_max) * 0.5f;
+			cluster.radius = 0.0f;
+
+			for (unsigned int i = 0; i < cluster.index_count; i++)
+				cluster.radius = std::max(cluster.radius, glm::length(glm::vec3(vertices[indices[i]].xyzw) - cluster.center));
+
+			//the cone axis averages the face normals, its width is set by the normal furthest from it
+			vector<glm::vec3> normals;
+			normals.reserve(cluster.index_count / 3);
+			glm::vec3 normal_sum(0.0f);
+
+			for (unsigned int i = 0; i < cluster.index_count; i += 3)
+			{
+				glm::vec3 p0(vertices[indices[i]].xyzw);
+				glm::vec3 normal = glm::cross(glm::vec3(vertices[indices[i + 1]].xyzw) - p0, glm::vec3(vertices[indices[i + 2]].xyzw) - p0);
+				float length = glm::length(normal);
+
+				if (length <= 0.0f)
+					continue;
+
+				normals.push_back(normal / length);
+				normal_sum += normals.back();
+			}
+
+			cluster.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+			cluster.cone_cutoff = 1.0f;
+
+			float axis_length = glm::length(normal_sum);
+			if (normals.empty() || axis_length <= 0.0f)
+				continue;
+
+			cluster.cone_axis = normal_sum / axis_length;
+
+			float min_dot = 1.0f;
+			for (const glm::vec3 &normal : normals)
+				min_dot = std::min(min_dot, glm::dot(normal, cluster.cone_axis));
+
+			if (min_dot > MESHLET_CONE_MIN_DOT)
+				cluster.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+		}
+	}
+}
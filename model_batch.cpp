@@ -0,0 +1,109 @@
+#include "ogl_tools.h"
+
+namespace jep
+{
+	//mtllib names are relative to the obj file naming them
+	string resolveRelativePath(const string &relative_to, const string &file_name)
+	{
+		bool absolute = !file_name.empty() && (file_name[0] == '/' || file_name[0] == '\\' || file_name.find(':') != string::npos);
+		size_t directory_end = relative_to.find_last_of("/\\");
+
+		if (absolute || directory_end == string::npos)
+			return file_name;
+
+		return relative_to.substr(0, directory_end + 1) + file_name;
+	}
+
+	//one mtl file parsed on a worker, shared by every model naming it
+	struct parsed_mtl
+	{
+		vector<material_description> descriptions;
+		vector<string> errors;
+	};
+
+	vector<loaded_model> loadModelBatch(const vector<string> &obj_files, boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context, int thread_count)
+	{
+		vector<loaded_model> models(obj_files.size());
+
+		//a file listed more than once is parsed once, by its first entry
+		map<string, int> first_model;
+
+		std::mutex mtl_mutex;
+		map<string, boost::shared_ptr<parsed_mtl> > mtl_files;
+
+		{
+			task_pool pool(thread_count);
+
+			for (int i = 0; i < int(obj_files.size()); i++)
+			{
+				models[i].obj_file = obj_files[i];
+
+				if (first_model.find(obj_files[i]) != first_model.end())
+					continue;
+
+				first_model[obj_files[i]] = i;
+
+				pool.submit([&, i]() {
+					loaded_model &model = models[i];
+
+					obj_contents contents(model.obj_file.c_str());
+					model.meshes = contents.takeMeshes();
+					model.errors = contents.getErrors();
+
+					if (contents.getMTLFilename().empty())
+						return;
+
+					model.mtl_file = resolveRelativePath(model.obj_file, contents.getMTLFilename());
+
+					boost::shared_ptr<parsed_mtl> parsed;
+					{
+						std::lock_guard<std::mutex> lock(mtl_mutex);
+
+						if (mtl_files.find(model.mtl_file) != mtl_files.end())
+							return;
+
+						parsed = boost::shared_ptr<parsed_mtl>(new parsed_mtl);
+						mtl_files[model.mtl_file] = parsed;
+					}
+
+					//submitted from this worker, so it lands on this worker's deque and idle workers steal it
+					string mtl_file = model.mtl_file;
+					pool.submit([parsed, mtl_file]() {
+						parseMaterialDescriptions(mtl_file.c_str(), parsed->descriptions, parsed->errors);
+					});
+				});
+			}
+
+			pool.wait();
+		}
+
+		for (int i = 0; i < int(models.size()); i++)
+		{
+			int first = first_model.at(models[i].obj_file);
+
+			if (first != i)
+			{
+				models[i].mtl_file = models[first].mtl_file;
+				models[i].meshes = models[first].meshes;
+				models[i].errors = models[first].errors;
+			}
+		}
+
+		//GL textures can only be created here, on the calling thread
+		map<string, map<string, boost::shared_ptr<material_data> > > materials;
+		for (const auto &mtl_pair : mtl_files)
+			materials[mtl_pair.first] = createMaterials(mtl_pair.first, mtl_pair.second->descriptions, textures, context, mtl_pair.second->errors);
+
+		for (loaded_model &model : models)
+		{
+			if (model.mtl_file.empty())
+				continue;
+
+			const parsed_mtl &parsed = *mtl_files.at(model.mtl_file);
+			model.materials = materials.at(model.mtl_file);
+			model.errors.insert(model.errors.end(), parsed.errors.begin(), parsed.errors.end());
+		}
+
+		return models;
+	}
+}
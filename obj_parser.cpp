@@ -1,277 +1,354 @@
 #include "ogl_tools.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace jep
 {
-	bool vertex_data::operator == (const vertex_data &other) const
+	vertex_data::vertex_data(array_view<float> p, array_view<float> uv_data, array_view<float> n) :
+		vertex_data()
 	{
-		if (getUVOffset() != other.getUVOffset())
-			return false;
+		if (p.size() < 3 || p.size() > 4)
+			throw std::invalid_argument("vertex position must have 3 or 4 values");
 
-		if (getNOffset() != other.getNOffset())
-			return false;
+		//"vt u v w" is valid obj, w is for 3d textures and isn't kept
+		if (uv_data.size() != 0 && uv_data.size() != 2 && uv_data.size() != 3)
+			throw std::invalid_argument("vertex uv must have 0, 2 or 3 values");
 
-		if (getStride() != other.getStride())
-			return false;
+		if (n.size() != 3 && n.size() != 0)
+			throw std::invalid_argument("vertex normal must have 0 or 3 values");
 
-		if (getVSize() != other.getVSize())
-			return false;
+		xyzw = glm::vec4(p[0], p[1], p[2], p.size() > 3 ? p[3] : 1.0f);
 
-		if (getVTSize() != other.getVTSize())
-			return false;
+		if (p.size() > 3)
+			attributes |= HAS_W;
+
+		if (uv_data.size() > 0)
+		{
+			uv = glm::vec2(uv_data[0], uv_data[1]);
+			attributes |= HAS_UV;
+		}
+
+		if (n.size() > 0)
+		{
+			n_xyz = glm::vec3(n[0], n[1], n[2]);
+			attributes |= HAS_NORMAL;
+		}
+	}
 
-		if (getVNSize() != other.getVNSize())
+	bool vertex_data::operator == (const vertex_data &other) const
+	{
+		if (attributes != other.attributes)
 			return false;
 
-		vector<float> other_v_data = other.getVData();
-		for (int i = 0; i < v_data.size(); i++)
+		for (int i = 0; i < getVSize(); i++)
 		{
-			if (!floatsAreEqual(v_data.at(i), other_v_data.at(i)))
-			{
+			if (!floatsAreEqual(xyzw[i], other.xyzw[i]))
 				return false;
-			}
 		}
 
-		vector<float> other_vt_data = other.getVTData();
-		for (int i = 0; i < vt_data.size(); i++)
+		for (int i = 0; i < getVTSize(); i++)
 		{
-			if (!floatsAreEqual(vt_data.at(i), other_vt_data.at(i)))
-			{
+			if (!floatsAreEqual(uv[i], other.uv[i]))
 				return false;
-			}
 		}
 
-		vector<float> other_vn_data = other.getVNData();
-		for (int i = 0; i < vn_data.size(); i++)
+		for (int i = 0; i < getVNSize(); i++)
 		{
-			if (!floatsAreEqual(vn_data.at(i), other_vn_data.at(i)))
-			{
+			if (!floatsAreEqual(n_xyz[i], other.n_xyz[i]))
 				return false;
-			}
 		}
 
 		return true;
 	}
 
-	void vertex_data::setVertexData()
+	void vertex_data::appendAllData(vector<float> &data) const
+	{
+		array_view<float> attribute_data[3] = { getVData(), getVTData(), getVNData() };
+
+		for (const array_view<float> &attribute : attribute_data)
+			data.insert(data.end(), attribute.begin(), attribute.end());
+	}
+
+	void vertex_data::modifyPosition(const glm::mat4 &translation_matrix)
+	{
+		xyzw = translation_matrix * xyzw;
+
+		//a vertex without w always reads back as w = 1
+		if (!(attributes & HAS_W))
+			xyzw.w = 1.0f;
+	}
+
+	void vertex_data::rotate(const glm::mat4 &rotation_matrix)
 	{
-		all_data.insert(all_data.end(), v_data.begin(), v_data.end());
-		all_data.insert(all_data.end(), vt_data.begin(), vt_data.end());
-		all_data.insert(all_data.end(), vn_data.begin(), vn_data.end());
+		modifyPosition(rotation_matrix);
 
-		if (v_data.size() > 0)
+		if (attributes & HAS_NORMAL)
 		{
-			x = v_data.at(0);
-			y = v_data.at(1);
-			z = v_data.at(2);
-			xy = glm::vec2(v_data.at(0), v_data.at(1));
-			xyz = glm::vec3(v_data.at(0), v_data.at(1), v_data.at(2));
+			n_xyz = glm::transpose(glm::inverse(glm::mat3(rotation_matrix))) * n_xyz;
 
-			if (v_data.size() > 3)
-			{
-				w = v_data.at(3);
-				xyzw = glm::vec4(v_data.at(0), v_data.at(1), v_data.at(2), v_data.at(3));
-			}
+			if (std::fabs(n_xyz.x) < 0.0001f)
+				n_xyz.x = 0.0f;
 
-			else
-			{
-				w = 1.0f;
-				xyzw = glm::vec4(v_data.at(0), v_data.at(1), v_data.at(2), 1.0f);
-			}
+			if (std::fabs(n_xyz.y) < 0.0001f)
+				n_xyz.y = 0.0f;
+
+			if (std::fabs(n_xyz.z) < 0.0001f)
+				n_xyz.z = 0.0f;
+
+			//n_xyz = glm::normalize(n_xyz);
 		}
+	}
 
-		else
+	//edge of the cells attribute values are quantized to, fine enough that few distinct vertices share a cell
+	const double VERTEX_HASH_CELL = 1.0 / 65536.0;
+	//shifts the cell edges off round values like 0, 0.5 and 1, so those don't need their neighbouring cell probed
+	const double VERTEX_HASH_CELL_OFFSET = 0.381966;
+	//past this, adjacent floats are further apart than the tolerance, so only an exact match is possible
+	const float VERTEX_HASH_EXACT_MAGNITUDE = 0.125f;
+	//past this, values are hashed by their bits rather than a cell number that would overflow
+	const float VERTEX_HASH_CELL_LIMIT = float(1 << 30);
+
+	unsigned long long mixHash(unsigned long long hash, unsigned long long value)
+	{
+		hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+		hash ^= hash >> 31;
+		hash *= 0xBF58476D1CE4E5B9ULL;
+		return hash;
+	}
+
+	//the cell one component falls in, false when it is hashed exactly and has no neighbouring cell to match in
+	//otherwise position is where in the cell grid it lies, cell is its floor
+	bool getHashCell(float value, unsigned long long &cell, double &position)
+	{
+		//also catches nan and infinity, which never compare equal anyway
+		if (!(std::fabs(value) < VERTEX_HASH_CELL_LIMIT))
+		{
+			unsigned int bits;
+			memcpy(&bits, &value, sizeof(bits));
+			cell = 0x8000000000000000ULL | bits;
+			return false;
+		}
+
+		position = value / VERTEX_HASH_CELL + VERTEX_HASH_CELL_OFFSET;
+		cell = (unsigned long long)(long long)std::floor(position);
+
+		return std::fabs(value) < VERTEX_HASH_EXACT_MAGNITUDE;
+	}
+
+	//vertices with different attributes never match, so the component counts lead every hash
+	unsigned long long hashAttributeSizes(const array_view<float>* attributes)
+	{
+		return mixHash(0, (unsigned long long)(attributes[0].size() | (attributes[1].size() << 8) | (attributes[2].size() << 16)));
+	}
+
+	unsigned long long vertex_hash_index::getCellHash(const vertex_data &vertex)
+	{
+		array_view<float> attributes[3] = { vertex.getVData(), vertex.getVTData(), vertex.getVNData() };
+		unsigned long long hash = hashAttributeSizes(attributes);
+
+		for (const array_view<float> &attribute : attributes)
 		{
-			x = 0.0f;
-			y = 0.0f;
-			z = 0.0f;
-			xy = glm::vec2(0.0f, 0.0f);
-			xyz = glm::vec3(0.0f, 0.0f, 0.0f);
-			w = 1.0f;
-			xyzw = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			for (float value : attribute)
+			{
+				unsigned long long cell;
+				double position;
+				getHashCell(value, cell, position);
+				hash = mixHash(hash, cell);
+			}
 		}
 
-		if (vt_data.size() > 0)
+		return hash;
+	}
+
+	int vertex_hash_index::getProbeHashes(const vertex_data &vertex, unsigned long long* hashes)
+	{
+		static_assert(vertex_data::MAX_COMPONENTS <= MAX_LINE_FLOATS * 3, "component arrays are too small for a vertex");
+		static_assert(MAX_PROBES >= 1 << vertex_data::MAX_COMPONENTS, "hashes can't hold a probe for every near edge combination");
+
+		array_view<float> attributes[3] = { vertex.getVData(), vertex.getVTData(), vertex.getVNData() };
+
+		//each component's own cell, and the neighbouring cell when it sits close enough to the edge to match there
+		unsigned long long cells[MAX_LINE_FLOATS * 3];
+		unsigned long long neighbours[MAX_LINE_FLOATS * 3];
+		int near_edge[MAX_LINE_FLOATS * 3];
+		int component_count = 0;
+		int near_edge_count = 0;
+
+		//in cells, doubled so rounding can't hide a match
+		const double margin = 2.0 * FLOAT_EQUALITY_TOLERANCE / VERTEX_HASH_CELL;
+
+		for (const array_view<float> &attribute : attributes)
 		{
-			if (vt_data.size() == 1)
+			for (float value : attribute)
 			{
-				for (int i = 0; i < all_data.size(); i++)
+				int n = component_count++;
+				double position;
+
+				if (!getHashCell(value, cells[n], position))
+					continue;
+
+				double cell = std::floor(position);
+
+				if (position - cell < margin)
 				{
-					cout << all_data[i] << endl;
+					neighbours[n] = cells[n] - 1;
+					near_edge[near_edge_count++] = n;
 				}
-			}
 
-			else {
-				u = vt_data.at(0);
-				v = vt_data.at(1);
-				uv = glm::vec2(vt_data.at(0), vt_data.at(1));
+				else if (cell + 1.0 - position < margin)
+				{
+					neighbours[n] = cells[n] + 1;
+					near_edge[near_edge_count++] = n;
+				}
 			}
 		}
 
-		else
-		{
-			u = 0.0f;
-			v = 0.0f;
-			uv = glm::vec2(0.0f, 0.0f);
-		}
+		//can't happen while vertex_data keeps to MAX_COMPONENTS, but hashes is only MAX_PROBES long
+		if (near_edge_count > vertex_data::MAX_COMPONENTS)
+			near_edge_count = vertex_data::MAX_COMPONENTS;
 
-		if (vn_data.size() > 0)
-		{
-			n_x = vn_data.at(0);
-			n_y = vn_data.at(1);
-			n_z = vn_data.at(2);
-			n_xy = glm::vec2(vn_data.at(0), vn_data.at(1));
-			n_xyz = glm::vec3(vn_data.at(0), vn_data.at(1), vn_data.at(2));
-		}
+		unsigned long long sizes_hash = hashAttributeSizes(attributes);
 
-		else
+		//every combination of own and neighbouring cells, the vertex's own cells (getCellHash) first
+		int hash_count = 1 << near_edge_count;
+		for (int combination = 0; combination < hash_count; combination++)
 		{
-			n_x = 0.0f;
-			n_y = 0.0f;
-			n_z = 0.0f;
-			n_xy = glm::vec2(0.0f, 0.0f);
-			n_xyz = glm::vec3(0.0f, 0.0f, 0.0f);
+			unsigned long long hash = sizes_hash;
+			int edge = 0;
+
+			for (int n = 0; n < component_count; n++)
+			{
+				bool use_neighbour = (edge < near_edge_count && near_edge[edge] == n) && ((combination >> edge++) & 1);
+				hash = mixHash(hash, use_neighbour ? neighbours[n] : cells[n]);
+			}
+
+			hashes[combination] = hash;
 		}
+
+		return hash_count;
 	}
 
-	void vertex_data::modifyPosition(const glm::mat4 &translation_matrix)
+	void vertex_hash_index::insert(const vertex_data &vertex, int index)
 	{
-		all_data.clear();
+		if ((entry_count + 1) * 2 > int(entries.size()))
+			grow();
 
-		v_data.clear();
-		xyzw = translation_matrix * xyzw;
-		v_data.push_back(xyzw.x);
-		v_data.push_back(xyzw.y);
-		v_data.push_back(xyzw.z);
+		//a vertex is stored under its own cells only, find probes the neighbouring ones
+		unsigned long long hash = getCellHash(vertex);
+
+		std::size_t mask = entries.size() - 1;
+		std::size_t slot = hash & mask;
 
-		if (v_count > 3)
-			v_data.push_back(xyzw.w);
+		while (entries[slot].index != -1)
+			slot = (slot + 1) & mask;
 
-		setVertexData();
+		entries[slot].hash = hash;
+		entries[slot].index = index;
+		entry_count++;
 	}
 
-	void vertex_data::rotate(const glm::mat4 &rotation_matrix)
+	//doubles the table, kept at most half full so probe runs stay short
+	void vertex_hash_index::grow()
 	{
-		all_data.clear();
-
-		v_data.clear();
-		xyzw = rotation_matrix * xyzw;
-		v_data.push_back(xyzw.x);
-		v_data.push_back(xyzw.y);
-		v_data.push_back(xyzw.z);
+		vector<entry> old_entries;
+		old_entries.swap(entries);
 
-		if (v_count > 3)
-			v_data.push_back(xyzw.w);
+		entries.assign(std::max<std::size_t>(64, old_entries.size() * 2), entry{ 0, -1 });
+		std::size_t mask = entries.size() - 1;
 
-		if (vn_count > 0)
+		for (const entry &old_entry : old_entries)
 		{
-			vn_data.clear();
-			n_xyz = glm::vec3(rotation_matrix * glm::vec4(n_xyz, 1.0f));
-
-			if (abs(n_xyz.x) < 0.0001f)
-				n_xyz.x = 0.0f;
-
-			if (abs(n_xyz.y) < 0.0001f)
-				n_xyz.y = 0.0f;
+			if (old_entry.index == -1)
+				continue;
 
-			if (abs(n_xyz.z) < 0.0001f)
-				n_xyz.z = 0.0f;
+			std::size_t slot = old_entry.hash & mask;
+			while (entries[slot].index != -1)
+				slot = (slot + 1) & mask;
 
-			//n_xyz = glm::normalize(n_xyz);
-			vn_data.push_back(n_xyz.x);
-			vn_data.push_back(n_xyz.y);
-			vn_data.push_back(n_xyz.z);
+			entries[slot] = old_entry;
 		}
-
-		setVertexData();
 	}
 
-	void mesh_data::addFace(const vector<vertex_data> &data)
+	void mesh_data::addFace(array_view<vertex_data> data)
 	{
-		faces.push_back(data);
 		total_face_count++;
 		vertex_count += data.size();
 
-		vector<glm::vec3> tangent_bitangent = calcTangentBitangent(data);
-
 		//add data to each respective all_data vector, for retrieving individual sets
-		for (vector<vertex_data>::const_iterator it = data.begin(); it != data.end(); it++)
+		for (const vertex_data &vertex : data)
 		{
-			addVData(it->getVData());
-			addVTData(it->getVTData());
-			addVNData(it->getVNData());
-
-			//adds tangent/bitangent once for each vertex
-			addTangentBitangent(tangent_bitangent);
+			addVData(vertex.getVData());
+			addVTData(vertex.getVTData());
+			addVNData(vertex.getVNData());
 		}
 
-		for (const auto &vertex : data)
-		{
-			bool match_found = false;
+		if (vertex_index.size() != int(vertices.size()))
+			rebuildVertexIndex();
 
-			//TODO use find methods instead of iterating through all vertices
-			for (const auto &vertex_pair : vertex_map)
-			{
-				if (vertex == vertex_pair.second)
-				{
-					element_index.push_back(vertex_pair.first);
-					match_found = true;
+		auto stored_vertex = [this](int n) -> const vertex_data& { return vertices[n]; };
 
-					//average tangents found with new tangents
-					tangent_map[vertex_pair.first] += tangent_bitangent[0];
-					bitangent_map[vertex_pair.first] += tangent_bitangent[1];
+		for (const auto &vertex : data)
+		{
+			int match = vertex_index.find(vertex, stored_vertex);
 
-					break;
-				}
-			}
+			if (match != -1)
+				element_index.push_back((unsigned int)match);
 
-			if (!match_found)
+			else
 			{
-				//add new index, vertex, tangent, and bitangent
-				unsigned short new_index = vertex_map.size();
+				//tangents are left to generateTangents, once every face sharing the vertex is known
+				unsigned int new_index = vertices.size();
 				element_index.push_back(new_index);
 
-				std::pair<unsigned short, vertex_data> vertex_to_add(new_index, vertex);
-				vertex_map.insert(vertex_to_add);
-
-				std::pair<unsigned short, glm::vec3> tangent_to_add(new_index, tangent_bitangent[0]);
-				tangent_map.insert(tangent_to_add);
-
-				std::pair<unsigned short, glm::vec3> bitangent_to_add(new_index, tangent_bitangent[1]);
-				bitangent_map.insert(bitangent_to_add);
+				vertex_index.insert(vertex, new_index);
+				vertices.push_back(vertex);
 			}
 		}
 	}
 
-	void mesh_data::addTangentBitangent(const vector<glm::vec3> &tb)
+	void mesh_data::rebuildVertexIndex()
 	{
-		for (int i = 0; i < 3; i++)
-		{
-			tangents.push_back(tb[0]);
-			bitangents.push_back(tb[1]);
-		}
+		vertex_index.clear();
+
+		for (int i = 0; i < int(vertices.size()); i++)
+			vertex_index.insert(vertices[i], i);
 	}
 
 	const vector<float> mesh_data::getInterleaveData() const
 	{
 		vector<float> interleave_data;
 		interleave_data.reserve(total_float_count);
-		for (vector< vector<vertex_data> >::const_iterator faces_it = faces.begin();
-		faces_it != faces.end(); faces_it++)
-		{
-			//object data format will be:
-			//		position.x, position.y, position.z, [position.w],
-			//		uv.x, [uv.y], [uv.w],
-			//		normal.x, normal.y, normal.z,
-			//	bracketed values are only included if they were in the original obj file
-
-			//for each vertex in each face, pass the stored, ordered data to interleave_data
-			for (vector<vertex_data>::const_iterator vertex_it = faces_it->begin();
-			vertex_it != faces_it->end(); vertex_it++)
-			{
-				vector<float> all_face_data(vertex_it->getAllData());
-				interleave_data.insert(interleave_data.end(), all_face_data.begin(), all_face_data.end());
-			}
-		}
+
+		//object data format will be:
+		//		position.x, position.y, position.z, [position.w],
+		//		uv.x, [uv.y], [uv.w],
+		//		normal.x, normal.y, normal.z,
+		//	bracketed values are only included if they were in the original obj file
+
+		//for each corner of each face, pass the stored, ordered data to interleave_data
+		for (unsigned int index : element_index)
+			vertices[index].appendAllData(interleave_data);
+
 		return interleave_data;
 	}
 
@@ -279,171 +356,66 @@ namespace jep
 	{
 		vector<float> all_data;
 
-		for (const auto vert_pair : vertex_map)
+		for (int i = 0; i < int(vertices.size()); i++)
 		{
 			//includes vertex position data, uv data, and normal data
-			vector<float> vertex_data_to_add = (vert_pair.second).getAllData();
+			vertices[i].appendAllData(all_data);
 
-			//append tangent data
-			glm::vec3 tangent_data = tangent_map.at(vert_pair.first);
-			vertex_data_to_add.push_back(tangent_data.x);
-			vertex_data_to_add.push_back(tangent_data.y);
-			vertex_data_to_add.push_back(tangent_data.z);
+			//append tangent data, the handedness is carried by the bitangent's direction
+			glm::vec3 tangent_data = i < int(vertex_tangents.size()) ? glm::vec3(vertex_tangents[i]) : glm::vec3(0.0f);
+			all_data.push_back(tangent_data.x);
+			all_data.push_back(tangent_data.y);
+			all_data.push_back(tangent_data.z);
 
 			//append bitangent data
-			glm::vec3 bitangent_data = bitangent_map.at(vert_pair.first);
-			vertex_data_to_add.push_back(bitangent_data.x);
-			vertex_data_to_add.push_back(bitangent_data.y);
-			vertex_data_to_add.push_back(bitangent_data.z);
-
-			all_data.insert(all_data.end(), vertex_data_to_add.begin(), vertex_data_to_add.end());
+			glm::vec3 bitangent_data = i < int(vertex_bitangents.size()) ? vertex_bitangents[i] : glm::vec3(0.0f);
+			all_data.push_back(bitangent_data.x);
+			all_data.push_back(bitangent_data.y);
+			all_data.push_back(bitangent_data.z);
 		}
 
 		return all_data;
 	}
 
-	const vector<float> mesh_data::getIndexedVertexData(vector<unsigned short> &indices) const
+	const vector<float> mesh_data::getIndexedVertexData(vector<unsigned int> &indices) const
 	{
 		vector<float> unique_vertices;
-		vector<float> interleaved_vertices = getInterleaveData();
 
-		vector<vertex_data> all_vertices;
+		vector<const vertex_data*> unique_vertex_list;
+		vertex_hash_index unique_index;
 
-		for (auto i : faces)
+		for (unsigned int index : element_index)
 		{
-			all_vertices.push_back(i.at(0));
-			all_vertices.push_back(i.at(1));
-			all_vertices.push_back(i.at(2));
-		}
-
-		map<unsigned short, vertex_data > vertex_map;
+			const vertex_data &vertex = vertices[index];
+			int match = unique_index.find(vertex, [&unique_vertex_list](int n) -> const vertex_data& { return *unique_vertex_list[n]; });
 
-		for (auto vertex : all_vertices)
-		{
-			bool match_found = false;
-			for (auto i : vertex_map)
-			{
-				if (vertex == i.second)
-				{
-					match_found = true;
-					indices.push_back(i.first);
-					break;
-				}
-			}
+			if (match != -1)
+				indices.push_back((unsigned int)match);
 
-			if (!match_found)
+			else
 			{
-				unsigned short new_index = vertex_map.size();
+				unsigned int new_index = unique_vertex_list.size();
 				indices.push_back(new_index);
-				vector<float> data_to_add = vertex.getAllData();
-				unique_vertices.insert(unique_vertices.end(), data_to_add.begin(), data_to_add.end());
-				vertex_map.insert(std::pair<unsigned short, vertex_data>(new_index, vertex));
+				vertex.appendAllData(unique_vertices);
+				unique_index.insert(vertex, unique_vertex_list.size());
+				unique_vertex_list.push_back(&vertex);
 			}
 		}
 
 		return unique_vertices;
 	}
 
-	void mesh_data::modifyPosition(const glm::mat4 &translation_matrix)
-	{
-		all_v_data.clear();
-
-		for (auto &face : faces)
-		{
-			for (auto &vertex : face)
-			{
-				vertex.modifyPosition(translation_matrix);
-				vector<float> vertex_v_data = vertex.getVData();
-				all_v_data.insert(all_v_data.end(), vertex_v_data.begin(), vertex_v_data.end());
-			}
-		}
-
-		for (auto &i : vertex_map)
-			i.second.modifyPosition(translation_matrix);
-	}
-
-	void mesh_data::rotate(const glm::mat4 &rotation_matrix)
-	{
-		all_v_data.clear();
-		all_vn_data.clear();
-
-		for (auto &face : faces)
-		{
-			for (auto &vertex : face)
-			{
-				vertex.rotate(rotation_matrix);
-				vector<float> vertex_v_data = vertex.getVData();
-				vector<float> vertex_vn_data = vertex.getVNData();
-				all_v_data.insert(all_v_data.end(), vertex_v_data.begin(), vertex_v_data.end());
-				all_vn_data.insert(all_vn_data.end(), vertex_vn_data.begin(), vertex_vn_data.end());
-			}
-		}
-
-		for (auto i : vertex_map)
-			i.second.rotate(rotation_matrix);
-	}
-
 	vector< std::pair<glm::vec4, glm::vec4> > mesh_data::getMeshEdgesVec4() const
 	{
-		map< int, std::pair<glm::vec4, glm::vec4> > edges;
-		int edge_counter = 0;
-
-		//for each side of each triangle
-		for (auto i : faces)
-		{
-			std::pair<glm::vec4, glm::vec4> edge1(i.at(0).xyzw, i.at(1).xyzw);
-			std::pair<glm::vec4, glm::vec4> edge2(i.at(1).xyzw, i.at(2).xyzw);
-			std::pair<glm::vec4, glm::vec4> edge3(i.at(2).xyzw, i.at(0).xyzw);
-
-			edges.insert(std::pair<int, std::pair<glm::vec4, glm::vec4> >(edge_counter++, edge1));
-			edges.insert(std::pair<int, std::pair<glm::vec4, glm::vec4> >(edge_counter++, edge2));
-			edges.insert(std::pair<int, std::pair<glm::vec4, glm::vec4> >(edge_counter++, edge3));
-		}
-
-		vector<int> unique_edges;
-		vector<int> shared_edges;
+		half_edge_mesh adjacency(*this);
+		vector< std::pair<glm::vec4, glm::vec4> > outer_edges;
 
-		for (auto i : edges)
+		for (unsigned int half_edge : adjacency.getBoundaryEdges())
 		{
-			//verity edge analyzed isn't already identified as shared
-			if (std::find(shared_edges.begin(), shared_edges.end(), i.first) != shared_edges.end())
-				continue;
-
-			std::pair<glm::vec4, glm::vec4> i_edge = i.second;
-
-			bool unique = true;
-
-			for (auto j : edges)
-			{
-				//skip if the edge has already been confirmed as unique or shared
-				if (std::find(shared_edges.begin(), shared_edges.end(), j.first) != shared_edges.end())
-					continue;
-
-				if (std::find(unique_edges.begin(), unique_edges.end(), j.first) != unique_edges.end())
-					continue;
-
-				std::pair<glm::vec4, glm::vec4> j_edge = j.second;
-
-				//if each edge has similar points, in any order, add to shared edges
-				if ((i_edge.second == j_edge.first && i_edge.second == j_edge.second) ||
-					(i_edge.first == j_edge.second && i_edge.second == j_edge.first))
-				{
-					shared_edges.push_back(i.first);
-					shared_edges.push_back(j.first);
-					unique = false;
-					break;
-				}
-			}
-
-			if (unique)
-				unique_edges.push_back(i.first);
+			outer_edges.push_back(std::pair<glm::vec4, glm::vec4>(
+				vertices[adjacency.getOrigin(half_edge)].xyzw, vertices[adjacency.getDestination(half_edge)].xyzw));
 		}
 
-		vector< std::pair<glm::vec4, glm::vec4> > outer_edges;
-
-		for (auto i : unique_edges)
-			outer_edges.push_back(edges.at(i));
-
 		return outer_edges;
 	}
 
@@ -465,12 +437,12 @@ namespace jep
 	{
 		vector< vector<glm::vec4> > triangles;
 
-		for (auto i : faces)
+		for (int i = 0; i + 2 < int(element_index.size()); i += 3)
 		{
 			vector<glm::vec4> triangle = {
-				i.at(0).xyzw,
-				i.at(1).xyzw,
-				i.at(2).xyzw
+				vertices[element_index[i]].xyzw,
+				vertices[element_index[i + 1]].xyzw,
+				vertices[element_index[i + 2]].xyzw
 			};
 
 			triangles.push_back(triangle);
@@ -483,12 +455,12 @@ namespace jep
 	{
 		vector< vector<glm::vec3> > triangles;
 
-		for (auto i : faces)
+		for (int i = 0; i + 2 < int(element_index.size()); i += 3)
 		{
 			vector<glm::vec3> triangle = {
-				i.at(0).xyz,
-				i.at(1).xyz,
-				i.at(2).xyz
+				glm::vec3(vertices[element_index[i]].xyzw),
+				glm::vec3(vertices[element_index[i + 1]].xyzw),
+				glm::vec3(vertices[element_index[i + 2]].xyzw)
 			};
 
 			triangles.push_back(triangle);
@@ -499,475 +471,1462 @@ namespace jep
 
 	void mesh_data::setMeshData()
 	{
-		if (faces.begin() != faces.end())
+		if (!element_index.empty())
 		{
-			interleave_stride = faces.begin()->begin()->getStride();
-			interleave_vt_offset = faces.begin()->begin()->getUVOffset();
-			interleave_vn_offset = faces.begin()->begin()->getNOffset();
+			const vertex_data &first_vertex = vertices[element_index.front()];
+			interleave_stride = first_vertex.getStride();
+			interleave_vt_offset = first_vertex.getUVOffset();
+			interleave_vn_offset = first_vertex.getNOffset();
 
-			v_size = faces.begin()->begin()->getVSize();
-			vt_size = faces.begin()->begin()->getVTSize();
-			vn_size = faces.begin()->begin()->getVNSize();
+			v_size = first_vertex.getVSize();
+			vt_size = first_vertex.getVTSize();
+			vn_size = first_vertex.getVNSize();
 
-			total_float_count = (v_size + vt_size + vn_size) * faces.size();
+			total_float_count = (v_size + vt_size + vn_size) * total_face_count;
 		}
 	}
 
-	vector<vertex_data> createFaceFromVertices(const vector<int> &indices, const vector<vertex_data> &vertices)
+	void addDataToMesh(mesh_data &mesh, array_view<vertex_data> vertices)
 	{
-		vector<vertex_data> returned_vertices;
-
-		for (vector<int>::const_iterator i = indices.cbegin(); i != indices.cend(); i++)
+		for (const vertex_data &vertex : vertices)
 		{
-			try
-			{
-				returned_vertices.push_back(vertices.at(*i));
-			}
-
-			catch (const std::out_of_range &oor) {}
+			mesh.addVData(vertex.getVData());
+			mesh.addVTData(vertex.getVTData());
+			mesh.addVNData(vertex.getVNData());
 		}
-
-		return returned_vertices;
 	}
 
-	void addDataToMesh(mesh_data &mesh, const vector<vertex_data> &vertices)
+	//v, vt, vn and vp
+	const int RAW_DATA_SLOTS = 4;
+
+	//slot of each raw element type within obj_parse_chunk
+	int rawDataSlot(DATA_TYPE dt)
 	{
-		for (vector<vertex_data>::const_iterator it = vertices.cbegin(); it != vertices.cend(); it++)
+		switch (dt)
 		{
-			mesh.addVData(it->getVData());
-			mesh.addVTData(it->getVTData());
-			mesh.addVNData(it->getVNData());
+		case OBJ_V: return 0;
+		case OBJ_VT: return 1;
+		case OBJ_VN: return 2;
+		case OBJ_VP: return 3;
+		default: return -1;
 		}
 	}
 
-	obj_contents::obj_contents(const char* obj_file)
+	//a line that shapes the mesh list, replayed in file order once every chunk has been tokenized
+	struct parse_record
 	{
-		v_index_counter = 1;
-		vt_index_counter = 1;
-		vn_index_counter = 1;
-		vp_index_counter = 1;
-
-		std::fstream file;
-		file.open(obj_file, std::ifstream::in);
-
-		if (!file.is_open())
-		{
-			string error = "unable to open obj file: ";
-			error += obj_file;
-			std::cout << error << std::endl;
-			error_log.push_back(error);
-			file.close();
-			return;
-		}
+		DATA_TYPE type;
+		//faces index into the chunk's corners, names and errors index into the chunk's strings
+		int first;
+		int count;
+	};
+
+	//a pool hands freed blocks back out, so scratch that is cleared after every line stays bounded
+	boost::shared_ptr<std::pmr::memory_resource> createLineScratch(std::pmr::memory_resource* upstream)
+	{
+		return boost::shared_ptr<std::pmr::memory_resource>(new std::pmr::unsynchronized_pool_resource(upstream));
+	}
 
-		bool end_of_vertex_data = false;
+	//everything tokenized from one line-aligned slice of an obj file
+	struct obj_parse_chunk
+	{
+		//by default the chunk's records, corners and strings go to an arena released with the chunk
+		explicit obj_parse_chunk(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+			obj_parse_chunk(boost::shared_ptr<std::pmr::memory_resource>(new std::pmr::monotonic_buffer_resource(upstream))) {}
+		explicit obj_parse_chunk(const boost::shared_ptr<std::pmr::memory_resource> &scratch_resource) :
+			scratch(scratch_resource), records(scratch.get()), corners(scratch.get()), strings(scratch.get()) {}
+
+		const char* begin;
+		const char* end;
+
+		//# of each raw element type defined before this chunk, and within it
+		int raw_base[RAW_DATA_SLOTS];
+		int raw_count[RAW_DATA_SLOTS];
+
+		//running totals while tokenizing, used to resolve relative face indices
+		int defined[RAW_DATA_SLOTS];
+
+		//destination of raw elements, when presized each chunk fills its own index range
+		//null when the elements are already loaded and only need counting
+		raw_element_array* raw_data[RAW_DATA_SLOTS];
+		bool raw_data_presized;
+
+		//shared by copies of the chunk, declared first so it outlives the containers drawing on it
+		boost::shared_ptr<std::pmr::memory_resource> scratch;
+		std::pmr::vector<parse_record> records;
+		std::pmr::vector<face_index> corners;
+		std::pmr::vector<std::pmr::string> strings;
+	};
+
+	//everything a streaming parse carries from one line to the next
+	struct obj_stream_state
+	{
+		obj_stream_state(std::pmr::memory_resource* resource) : chunk(createLineScratch(resource)), mesh(resource) {}
 
-		meshes.push_back(mesh_data());
-		vector<mesh_data>::iterator current_mesh = meshes.begin();
+		obj_parse_chunk chunk;
+		bool end_of_vertex_data;
+		string current_material;
 
-		vector<DATA_TYPE> index_order;
+		//the only mesh held, handed to on_mesh as soon as the next one starts
+		mesh_data mesh;
 
-		string current_material;
+		//scratch buffer reused by every face
+		vector<face_index> face_corners;
+	};
 
-		while (!file.eof())
+	//runs task(0) ... task(task_count - 1), spread across up to thread_count threads
+	void runParallel(int thread_count, int task_count, const std::function<void(int)> &task)
+	{
+		if (thread_count <= 1 || task_count <= 1)
 		{
-			string line;
-			std::getline(file, line, '\n');
+			for (int i = 0; i < task_count; i++)
+				task(i);
 
-			DATA_TYPE type = getDataType(line);
+			return;
+		}
 
-			if (type == UNDEFINED_DATA_TYPE)
-				continue;
+		std::atomic<int> next_task(0);
+		vector<std::thread> workers;
 
-			//"g" prefix indicates the previous geometry data has ended
-			else if (type == OBJ_G)
-			{
-				current_mesh->setMeshName(extractName(line));
-				end_of_vertex_data = true;
-				continue;
-			}
+		for (int i = 0; i < std::min(thread_count, task_count); i++)
+		{
+			workers.push_back(std::thread([&]() {
+				for (int n = next_task++; n < task_count; n = next_task++)
+					task(n);
+			}));
+		}
 
-			if (type == OBJ_USEMTL)
-			{
-				current_material = extractName(line);
-				current_mesh->setMaterialName(current_material);
-				continue;
-			}
+		for (std::thread &worker : workers)
+			worker.join();
+	}
 
-			if (type == OBJ_MTLLIB)
-			{
-				mtl_filename = extractName(line);
-				continue;
-			}
+	//splits [begin, end) into up to chunk_count pieces that each start at the beginning of a line
+	//each chunk gets its own scratch arena drawing on upstream
+	vector<obj_parse_chunk> splitIntoChunks(const char* begin, const char* end, int chunk_count, std::pmr::memory_resource* upstream)
+	{
+		//small files aren't worth the thread overhead
+		const size_t min_chunk_size = 1 << 20;
+		size_t total_size = end - begin;
+		chunk_count = int(std::max<size_t>(1, std::min<size_t>(chunk_count, total_size / min_chunk_size)));
 
-			//detects if a new geometry is starting, resets params and operates on new mesh
-			if (type == OBJ_V && end_of_vertex_data)
-			{
-				meshes.push_back(mesh_data());
-				current_mesh = meshes.end() - 1;
-				current_mesh->setMaterialName(current_material);
-				end_of_vertex_data = false;
-				index_order.clear();
-			}
+		vector<obj_parse_chunk> chunks;
+		chunks.reserve(chunk_count);
+		const char* chunk_begin = begin;
 
-			if (type == OBJ_V || type == OBJ_VT || type == OBJ_VN || type == OBJ_VP)
-			{
-				if (std::find(index_order.begin(), index_order.end(), type) == index_order.end())
-					index_order.push_back(type);
+		for (int i = 0; i < chunk_count; i++)
+		{
+			const char* chunk_end = (i == chunk_count - 1) ? end : begin + (total_size / chunk_count) * (i + 1);
 
-				vector<float> floats(extractFloats(line));
-				addRawData(floats, type);
-			}
+			if (chunk_end < chunk_begin)
+				chunk_end = chunk_begin;
 
-			else if (type == OBJ_F)
+			//move the split point past the end of the line it falls in
+			if (chunk_end != end && chunk_end != chunk_begin && *(chunk_end - 1) != '\n')
 			{
-				//face_data contains the index list for each line (each face)
-				//	1/1/1  2/2/2  3/3/3
-				vector< vector<int> > extracted_face_data(extractFaceSequence(line));
-
-				//generate vertex data objects from sequences passed
-				vector<vertex_data> extracted_vertices;
-				for (int i = 0; i < extracted_face_data.size(); i++)
-				{
-					int v_index = 0;
-					int vt_index = 0;
-					int vn_index = 0;
-					int vp_index = 0;
-					vector<float> position_data;
-					vector<float> uv_data;
-					vector<float> normal_data;
-
-					for (int n = 0; n < index_order.size(); n++)
-					{
-						if (v_index = extracted_face_data[i][n] == 0)
-							continue;
-
-						switch (index_order[n])
-						{
-						case OBJ_V:
-							v_index = extracted_face_data[i][n];
-							position_data = raw_v_data.at(v_index);
-							break;
-						case OBJ_VT:
-							vt_index = extracted_face_data[i][n];
-							uv_data = raw_vt_data.at(vt_index);
-							break;
-						case OBJ_VN:
-							vn_index = extracted_face_data[i][n];
-							normal_data = raw_vn_data.at(vn_index);
-							break;
-						case OBJ_VP:
-							vp_index = extracted_face_data[i][n];
-							break;
-						default: throw;
-						}
-					}
+				const char* line_end = static_cast<const char*>(memchr(chunk_end, '\n', end - chunk_end));
+				chunk_end = (line_end == nullptr) ? end : line_end + 1;
+			}
 
-					vertex_data vert(position_data, uv_data, normal_data);
-					extracted_vertices.push_back(vert);
-				}
+			chunks.emplace_back(upstream);
+			chunks[i].begin = chunk_begin;
+			chunks[i].end = chunk_end;
+			chunk_begin = chunk_end;
+		}
 
-				//while loop allows for obj file to contain faces with >3 vertices
-				int first = 0;
-				int second = 1;
-				int third = 2;
+		return chunks;
+	}
 
-				while (third < extracted_face_data.size())
-				{
-					vector<vertex_data> face = createFaceFromVertices({ first, second, third }, extracted_vertices);
-					current_mesh->addFace(face);
+	void countChunkElements(obj_parse_chunk &chunk)
+	{
+		for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
+			chunk.raw_count[slot] = 0;
 
-					if (second != first + 1)
-						addDataToMesh(*current_mesh, face);
+		const char* cursor = chunk.begin;
+		while (cursor != chunk.end)
+		{
+			int slot = rawDataSlot(getDataType(nextLine(cursor, chunk.end)));
 
-					second++;
-					third++;
-				}
-			}
+			if (slot >= 0)
+				chunk.raw_count[slot]++;
 		}
-		file.close();
-
-		for (vector<mesh_data>::iterator it = meshes.begin(); it != meshes.end(); it++)
-			it->setMeshData();
 	}
 
-	// added for gen art project, used to generate matrices from a pre-made model
-	vector<glm::vec4> obj_contents::getAllVerticesOfAllMeshes() const
+	string_view extractNameView(string_view line)
 	{
-		vector<glm::vec4> all_vertices;
-		for (const mesh_data &mesh : meshes)
-		{
-			map<unsigned short, vertex_data> vertex_map = mesh.getVertexMap();
-			for (const std::pair<unsigned short, vertex_data> &vertex_pair : vertex_map)
-			{
-				all_vertices.push_back(vertex_pair.second.xyzw);
-			}
-		}
+		//name is everything following the first space
+		size_t name_begin = line.find(' ');
+		if (name_begin == string_view::npos)
+			return string_view();
 
-		return all_vertices;
+		return line.substr(name_begin + 1);
 	}
 
-	vector<glm::vec3> mesh_data::calcTangentBitangent(const vector<vertex_data> &face_data)
+	void tokenizeLine(obj_parse_chunk &chunk, string_view line, vector<face_index> &face_corners)
 	{
-		vertex_data v_data_0 = face_data[0];
-		vertex_data v_data_1 = face_data[1];
-		vertex_data v_data_2 = face_data[2];
+		DATA_TYPE type = getDataType(line);
 
-		glm::vec3 v0(v_data_0.getVData()[0], v_data_0.getVData()[1], v_data_0.getVData()[2]);
-		glm::vec3 v1(v_data_1.getVData()[0], v_data_1.getVData()[1], v_data_1.getVData()[2]);
-		glm::vec3 v2(v_data_2.getVData()[0], v_data_2.getVData()[1], v_data_2.getVData()[2]);
+		switch (type)
+		{
+		case OBJ_V:
+		case OBJ_VT:
+		case OBJ_VN:
+		case OBJ_VP:
+		{
+			int slot = rawDataSlot(type);
+			chunk.defined[slot]++;
 
-		vector<float> uv0_vtdata = v_data_0.getVTData();
-		glm::vec2 uv0(uv0_vtdata.size() > 1 ? uv0_vtdata[0] : 0.0, uv0_vtdata.size() > 1 ? uv0_vtdata[1] : 0.0);
+			if (chunk.raw_data[slot] != nullptr)
+			{
+				float floats[MAX_LINE_FLOATS];
+				int float_count = extractFloats(line, floats, MAX_LINE_FLOATS);
 
-		vector<float> uv1_vtdata = v_data_1.getVTData();
-		glm::vec2 uv1(uv1_vtdata.size() > 1 ? uv1_vtdata[0] : 1.0, uv1_vtdata.size() > 1 ? uv1_vtdata[1] : 1.0);
+				if (chunk.raw_data_presized)
+					chunk.raw_data[slot]->set(chunk.defined[slot], floats, float_count);
 
-		vector<float> uv2_vtdata = v_data_2.getVTData();
-		glm::vec2 uv2(uv2_vtdata.size() > 1 ? uv2_vtdata[0] : 1.0, uv2_vtdata.size() > 1 ? uv2_vtdata[1] : 0.0);
+				else chunk.raw_data[slot]->add(floats, float_count);
+			}
 
-		glm::vec3 deltaPos1 = v1 - v0;
-		glm::vec3 deltaPos2 = v2 - v0;
+			//only the first "v" of a run matters when splitting meshes
+			if (type == OBJ_V && (chunk.records.empty() || chunk.records.back().type != OBJ_V))
+				chunk.records.push_back({ OBJ_V, 0, 0 });
 
-		glm::vec2 deltaUV1 = uv1 - uv0;
-		glm::vec2 deltaUV2 = uv2 - uv0;
+			break;
+		}
 
-		float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
-		glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
-		glm::vec3 bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
+		case OBJ_F:
+		{
+			extractFaceSequence(line, face_corners, chunk.defined[0], chunk.defined[1], chunk.defined[2]);
+
+			//fewer than 3 corners make no triangle, and a bare "f" would leave a record pointing past the corners
+			if (face_corners.size() < 3)
+				break;
+
+			bool valid = true;
+			for (const face_index &corner : face_corners)
+			{
+				if (corner.v < 1 || corner.v > chunk.defined[0] ||
+					corner.vt < 0 || corner.vt > chunk.defined[1] ||
+					corner.vn < 0 || corner.vn > chunk.defined[2])
+				{
+					valid = false;
+					break;
+				}
+			}
+
+			if (!valid)
+			{
+				string error = "face references undefined vertex data: ";
+				error += string(line);
+				chunk.records.push_back({ UNDEFINED_DATA_TYPE, int(chunk.strings.size()), 0 });
+				chunk.strings.emplace_back(error);
+				break;
+			}
+
+			chunk.records.push_back({ OBJ_F, int(chunk.corners.size()), int(face_corners.size()) });
+			chunk.corners.insert(chunk.corners.end(), face_corners.begin(), face_corners.end());
+			break;
+		}
+
+		case OBJ_G:
+		case OBJ_USEMTL:
+		case OBJ_MTLLIB:
+			chunk.records.push_back({ type, int(chunk.strings.size()), 0 });
+			chunk.strings.emplace_back(extractNameView(line));
+			break;
+
+		default: break;
+		}
+	}
+
+	void tokenizeChunk(obj_parse_chunk &chunk)
+	{
+		for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
+			chunk.defined[slot] = chunk.raw_base[slot];
+
+		vector<face_index> face_corners;
+
+		const char* cursor = chunk.begin;
+		while (cursor != chunk.end)
+			tokenizeLine(chunk, nextLine(cursor, chunk.end), face_corners);
+	}
+
+	std::pmr::memory_resource* resourceOrDefault(std::pmr::memory_resource* resource)
+	{
+		return resource != nullptr ? resource : std::pmr::get_default_resource();
+	}
+
+	obj_contents::obj_contents(const char* obj_file, int thread_count, obj_parse_timings* timings, std::pmr::memory_resource* resource) :
+		raw_v_data(4), raw_vt_data(3), raw_vn_data(3), raw_vp_data(3), mesh_resource(resourceOrDefault(resource)), source_data(nullptr)
+	{
+		//compressed files and files that won't open never reach parseContents, their timings read as zero
+		if (timings != nullptr)
+			*timings = obj_parse_timings();
+
+		if (compressed_reader::getCompression(obj_file) != NO_COMPRESSION)
+		{
+			streamCompressed(obj_file, [this](mesh_data &mesh) { meshes.push_back(std::move(mesh)); }, progress_callback());
+			return;
+		}
+
+		file_mapping file(obj_file);
+
+		if (!file.isOpen())
+		{
+			string error = "unable to open obj file: ";
+			error += obj_file;
+			std::cout << error << std::endl;
+			error_log.push_back(error);
+			return;
+		}
+
+		parseContents(file.data(), file.data() + file.size(), thread_count, timings);
+	}
+
+	obj_contents::obj_contents(array_view<char> obj_data, int thread_count, obj_parse_timings* timings, std::pmr::memory_resource* resource) :
+		raw_v_data(4), raw_vt_data(3), raw_vn_data(3), raw_vp_data(3), mesh_resource(resourceOrDefault(resource)), source_data(nullptr)
+	{
+		parseContents(obj_data.begin(), obj_data.end(), thread_count, timings);
+	}
+
+	obj_contents::obj_contents(const char* obj_file, const mesh_callback &on_mesh, const progress_callback &on_progress,
+		std::pmr::memory_resource* resource) :
+		raw_v_data(4), raw_vt_data(3), raw_vn_data(3), raw_vp_data(3), mesh_resource(resourceOrDefault(resource)), source_data(nullptr)
+	{
+		if (compressed_reader::getCompression(obj_file) != NO_COMPRESSION)
+		{
+			streamCompressed(obj_file, on_mesh, on_progress);
+			return;
+		}
+
+		file_mapping file(obj_file);
+
+		if (!file.isOpen())
+		{
+			string error = "unable to open obj file: ";
+			error += obj_file;
+			std::cout << error << std::endl;
+			error_log.push_back(error);
+			return;
+		}
+
+		streamContents(file.data(), file.data() + file.size(), &file, on_mesh, on_progress);
+	}
+
+	obj_contents::obj_contents(array_view<char> obj_data, const mesh_callback &on_mesh, const progress_callback &on_progress,
+		std::pmr::memory_resource* resource) :
+		raw_v_data(4), raw_vt_data(3), raw_vn_data(3), raw_vp_data(3), mesh_resource(resourceOrDefault(resource)), source_data(nullptr)
+	{
+		streamContents(obj_data.begin(), obj_data.end(), nullptr, on_mesh, on_progress);
+	}
+
+	obj_contents::obj_contents(const char* obj_file, obj_load_mode mode, std::pmr::memory_resource* resource) :
+		raw_v_data(4), raw_vt_data(3), raw_vn_data(3), raw_vp_data(3), mesh_resource(resourceOrDefault(resource)), source_data(nullptr)
+	{
+		//indexed meshes are rebuilt from their byte ranges later, so compressed text is kept whole in memory
+		if (compressed_reader::getCompression(obj_file) != NO_COMPRESSION && mode == OBJ_LOAD_INDEX)
+		{
+			compressed_reader reader(obj_file);
+
+			if (!reader.isOpen())
+			{
+				string error = "unable to open obj file: ";
+				error += obj_file;
+				std::cout << error << std::endl;
+				error_log.push_back(error);
+				return;
+			}
+
+			source_text = boost::shared_ptr<string>(new string());
+
+			string block;
+			while (reader.nextBlock(block))
+				source_text->append(block);
+
+			if (!reader.getError().empty())
+			{
+				std::cout << reader.getError() << std::endl;
+				error_log.push_back(reader.getError());
+				return;
+			}
+
+			source_data = source_text->data();
+			indexContents(source_text->data(), source_text->data() + source_text->size());
+			return;
+		}
+
+		if (compressed_reader::getCompression(obj_file) != NO_COMPRESSION)
+		{
+			streamCompressed(obj_file, [this](mesh_data &mesh) { meshes.push_back(std::move(mesh)); }, progress_callback());
+			return;
+		}
+
+		source_file = boost::shared_ptr<file_mapping>(new file_mapping(obj_file));
+
+		if (!source_file->isOpen())
+		{
+			string error = "unable to open obj file: ";
+			error += obj_file;
+			std::cout << error << std::endl;
+			error_log.push_back(error);
+			return;
+		}
+
+		if (mode == OBJ_LOAD_INDEX)
+		{
+			source_data = source_file->data();
+			indexContents(source_file->data(), source_file->data() + source_file->size());
+		}
+
+		else
+		{
+			parseContents(source_file->data(), source_file->data() + source_file->size(), 1, nullptr);
+			source_file.reset();
+		}
+	}
+
+	obj_contents::obj_contents(array_view<char> obj_data, obj_load_mode mode, std::pmr::memory_resource* resource) :
+		raw_v_data(4), raw_vt_data(3), raw_vn_data(3), raw_vp_data(3), mesh_resource(resourceOrDefault(resource)), source_data(nullptr)
+	{
+		if (mode == OBJ_LOAD_INDEX)
+		{
+			source_data = obj_data.data();
+			indexContents(obj_data.begin(), obj_data.end());
+		}
+
+		else parseContents(obj_data.begin(), obj_data.end(), 1, nullptr);
+	}
+
+	double secondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void obj_contents::parseContents(const char* begin, const char* end, int thread_count, obj_parse_timings* timings)
+	{
+		if (thread_count < 1)
+			thread_count = std::max(1, int(std::thread::hardware_concurrency()));
+
+		if (timings != nullptr)
+			*timings = obj_parse_timings();
+
+		std::chrono::steady_clock::time_point stage_start = std::chrono::steady_clock::now();
+
+		//chunk arenas hold the tokenized lines until every mesh is built, then are released together
+		vector<obj_parse_chunk> chunks(splitIntoChunks(begin, end, thread_count, mesh_resource));
+
+		//element counts per chunk give every chunk its global index offsets before tokenizing
+		if (chunks.size() > 1)
+		{
+			runParallel(thread_count, chunks.size(), [&chunks](int i) { countChunkElements(chunks[i]); });
+		}
+
+		if (timings != nullptr)
+		{
+			timings->count_seconds = secondsSince(stage_start);
+			stage_start = std::chrono::steady_clock::now();
+		}
+
+		raw_element_array* raw_data[RAW_DATA_SLOTS] = { &raw_v_data, &raw_vt_data, &raw_vn_data, &raw_vp_data };
+
+		int totals[RAW_DATA_SLOTS] = { 0, 0, 0, 0 };
+		for (obj_parse_chunk &chunk : chunks)
+		{
+			//a single chunk skips the counting pass and appends as it goes
+			chunk.raw_data_presized = (chunks.size() > 1);
+
+			for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
+			{
+				chunk.raw_base[slot] = totals[slot];
+				chunk.raw_data[slot] = raw_data[slot];
+
+				if (chunk.raw_data_presized)
+					totals[slot] += chunk.raw_count[slot];
+			}
+		}
+
+		if (chunks.size() > 1)
+		{
+			for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
+				raw_data[slot]->resize(totals[slot]);
+		}
+
+		runParallel(thread_count, chunks.size(), [&chunks](int i) { tokenizeChunk(chunks[i]); });
+
+		if (timings != nullptr)
+		{
+			timings->tokenize_seconds = secondsSince(stage_start);
+			stage_start = std::chrono::steady_clock::now();
+		}
+
+		vector< vector< array_view<face_index> > > mesh_faces;
+		mergeChunks(chunks, mesh_faces);
+
+		if (timings != nullptr)
+		{
+			timings->merge_seconds = secondsSince(stage_start);
+			stage_start = std::chrono::steady_clock::now();
+		}
+
+		//per mesh, so threads never share a counter
+		vector<double> resolution_seconds(timings != nullptr ? meshes.size() : 0, 0.0);
+		vector<double> assembly_seconds(resolution_seconds.size(), 0.0);
+		vector<unsigned long long> scratch_allocations(resolution_seconds.size(), 0);
+
+		//meshes don't share any state, so each one is assembled independently
+		runParallel(thread_count, meshes.size(), [&](int i) {
+			if (timings != nullptr)
+				buildMesh(meshes[i], mesh_faces[i], &resolution_seconds[i], &assembly_seconds[i], &scratch_allocations[i]);
+
+			else buildMesh(meshes[i], mesh_faces[i]);
+
+			meshes[i].setMeshData();
+		});
+
+		if (timings != nullptr)
+		{
+			timings->build_seconds = secondsSince(stage_start);
+			stage_start = std::chrono::steady_clock::now();
+		}
+
+		//one mesh is often most of the file, so each one is spread across the threads rather than meshes across them
+		for (mesh_data &mesh : meshes)
+			mesh.generateTangents(thread_count);
+
+		if (timings != nullptr)
+		{
+			timings->tangent_seconds = secondsSince(stage_start);
+
+			for (int i = 0; i < int(resolution_seconds.size()); i++)
+			{
+				timings->face_resolution_seconds += resolution_seconds[i];
+				timings->mesh_assembly_seconds += assembly_seconds[i];
+				timings->scratch_allocations += scratch_allocations[i];
+			}
+		}
+	}
+
+	void obj_contents::mergeChunks(const vector<obj_parse_chunk> &chunks, vector< vector< array_view<face_index> > > &mesh_faces)
+	{
+		bool end_of_vertex_data = false;
+		string current_material;
+
+		meshes.push_back(mesh_data(mesh_resource));
+		mesh_faces.push_back(vector< array_view<face_index> >());
+
+		//replays structural lines in file order so mesh boundaries match a front to back read
+		for (const obj_parse_chunk &chunk : chunks)
+		{
+			for (const parse_record &record : chunk.records)
+			{
+				if (record.type == OBJ_F)
+					mesh_faces.back().push_back(array_view<face_index>(chunk.corners.data() + record.first, record.count));
+
+				else if (applyRecord(chunk, record, meshes.back(), end_of_vertex_data, current_material))
+				{
+					meshes.push_back(mesh_data(mesh_resource));
+					mesh_faces.push_back(vector< array_view<face_index> >());
+					meshes.back().setMaterialName(current_material);
+				}
+			}
+		}
+	}
+
+	bool obj_contents::applyRecord(const obj_parse_chunk &chunk, const parse_record &record, mesh_data &mesh,
+		bool &end_of_vertex_data, string &current_material)
+	{
+		switch (record.type)
+		{
+		//"g" prefix indicates the previous geometry data has ended
+		case OBJ_G:
+			mesh.setMeshName(string(chunk.strings[record.first]));
+			end_of_vertex_data = true;
+			return false;
+
+		case OBJ_USEMTL:
+			current_material = string(chunk.strings[record.first]);
+			mesh.setMaterialName(current_material);
+			return false;
+
+		case OBJ_MTLLIB:
+			mtl_filename = string(chunk.strings[record.first]);
+			return false;
+
+		//detects if a new geometry is starting
+		case OBJ_V:
+			if (!end_of_vertex_data)
+				return false;
+
+			end_of_vertex_data = false;
+			return true;
+
+		default:
+			error_log.push_back(string(chunk.strings[record.first]));
+			return false;
+		}
+	}
+
+	void obj_contents::buildMesh(mesh_data &mesh, const vector< array_view<face_index> > &faces, double* resolution_seconds,
+		double* assembly_seconds, unsigned long long* scratch_allocations) const
+	{
+		for (const array_view<face_index> &corners : faces)
+			buildFace(mesh, corners, resolution_seconds, assembly_seconds, scratch_allocations);
+	}
+
+	//resizes an element the tokenizer kept to a size vertex_data takes, the stride past its floats is zeroed
+	//so "v x y" gets z = 0, "vt u" gets v = 0 and partial normals are padded, an empty uv or normal stays empty
+	array_view<float> fitElement(array_view<float> element, std::size_t min_size, bool keep_empty)
+	{
+		if (keep_empty && element.empty())
+			return element;
+
+		return array_view<float>(element.data(), std::max(min_size, element.size()));
+	}
+
+	void obj_contents::buildFace(mesh_data &mesh, array_view<face_index> corners, double* resolution_seconds,
+		double* assembly_seconds, unsigned long long* scratch_allocations) const
+	{
+		const array_view<float> no_data;
+		const bool timed = (resolution_seconds != nullptr && assembly_seconds != nullptr);
+
+		std::chrono::steady_clock::time_point stage_start;
+		if (timed)
+			stage_start = std::chrono::steady_clock::now();
+
+		//the face's vertices live in an arena that starts on the stack and is dropped as a whole once the face is added
+		//only n-gons with many corners outgrow the buffer and reach the mesh's resource
+		char scratch_buffer[8192];
+		std::pmr::monotonic_buffer_resource face_arena(scratch_buffer, sizeof(scratch_buffer), mesh_resource);
+		counting_resource counted_arena(&face_arena);
+		std::pmr::memory_resource* scratch = &face_arena;
+
+		if (scratch_allocations != nullptr)
+			scratch = &counted_arena;
+
+		//generate vertex data objects from the corners passed
+		//	1/1/1  2/2/2  3/3/3
+		std::pmr::vector<vertex_data> extracted_vertices(scratch);
+		extracted_vertices.reserve(corners.size());
+
+		for (const face_index &corner : corners)
+		{
+			extracted_vertices.emplace_back(
+				fitElement(raw_v_data.at(corner.v), 3, false),
+				corner.vt != 0 ? fitElement(raw_vt_data.at(corner.vt), 2, true) : no_data,
+				corner.vn != 0 ? fitElement(raw_vn_data.at(corner.vn), 3, true) : no_data);
+		}
+
+		if (timed)
+		{
+			*resolution_seconds += secondsSince(stage_start);
+			stage_start = std::chrono::steady_clock::now();
+		}
+
+		//while loop allows for obj file to contain faces with >3 vertices
+		int first = 0;
+		int second = 1;
+		int third = 2;
+
+		vertex_data face[3];
+
+		while (third < extracted_vertices.size())
+		{
+			face[0] = extracted_vertices[first];
+			face[1] = extracted_vertices[second];
+			face[2] = extracted_vertices[third];
+			mesh.addFace(array_view<vertex_data>(face, 3));
+
+			if (second != first + 1)
+				addDataToMesh(mesh, array_view<vertex_data>(face, 3));
+
+			second++;
+			third++;
+		}
+
+		if (timed)
+			*assembly_seconds += secondsSince(stage_start);
+
+		if (scratch_allocations != nullptr)
+			*scratch_allocations += counted_arena.getAllocationCount();
+	}
+
+	void obj_contents::beginStream(obj_stream_state &state)
+	{
+		state.chunk.begin = nullptr;
+		state.chunk.end = nullptr;
+		state.chunk.raw_data_presized = false;
+
+		raw_element_array* raw_data[RAW_DATA_SLOTS] = { &raw_v_data, &raw_vt_data, &raw_vn_data, &raw_vp_data };
+		for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
+		{
+			state.chunk.raw_base[slot] = 0;
+			state.chunk.raw_count[slot] = 0;
+			state.chunk.defined[slot] = 0;
+			state.chunk.raw_data[slot] = raw_data[slot];
+		}
+
+		state.end_of_vertex_data = false;
+	}
+
+	void obj_contents::streamLine(obj_stream_state &state, string_view line, const mesh_callback &on_mesh)
+	{
+		obj_parse_chunk &chunk = state.chunk;
+		tokenizeLine(chunk, line, state.face_corners);
+
+		//records are applied as soon as they're read, so only the open mesh is ever held
+		for (const parse_record &record : chunk.records)
+		{
+			if (record.type == OBJ_F)
+				buildFace(state.mesh, array_view<face_index>(chunk.corners.data() + record.first, record.count));
+
+			else if (applyRecord(chunk, record, state.mesh, state.end_of_vertex_data, state.current_material))
+			{
+				state.mesh.setMeshData();
+				state.mesh.generateTangents();
+				on_mesh(state.mesh);
+
+				state.mesh = mesh_data(mesh_resource);
+				state.mesh.setMaterialName(state.current_material);
+			}
+		}
+
+		chunk.records.clear();
+		chunk.corners.clear();
+		chunk.strings.clear();
+	}
+
+	void obj_contents::endStream(obj_stream_state &state, const mesh_callback &on_mesh)
+	{
+		state.mesh.setMeshData();
+		state.mesh.generateTangents();
+		on_mesh(state.mesh);
+	}
+
+	void obj_contents::streamContents(const char* begin, const char* end, const file_mapping* file,
+		const mesh_callback &on_mesh, const progress_callback &on_progress)
+	{
+		//consumed parts of a mapped file are handed back to the os in blocks of this size
+		const size_t release_block_size = 16 << 20;
+		const size_t progress_block_size = 1 << 20;
+		const size_t total_size = end - begin;
+
+		if (on_progress && !on_progress(0, total_size))
+			return;
+
+		obj_stream_state state(mesh_resource);
+		beginStream(state);
+
+		const char* released = begin;
+		const char* reported = begin;
+		const char* cursor = begin;
+
+		while (cursor != end)
+		{
+			streamLine(state, nextLine(cursor, end), on_mesh);
+
+			if (file != nullptr && size_t(cursor - released) >= release_block_size)
+			{
+				file->release(released - file->data(), cursor - released);
+				released = cursor;
+			}
+
+			if (on_progress && size_t(cursor - reported) >= progress_block_size)
+			{
+				reported = cursor;
+
+				//a stopped parse drops the open mesh rather than emitting it half built
+				if (!on_progress(cursor - begin, total_size))
+					return;
+			}
+		}
+
+		endStream(state, on_mesh);
+
+		if (on_progress)
+			on_progress(total_size, total_size);
+	}
+
+	//progress is reported in compressed bytes, the decompressed size isn't known until the end
+	bool obj_contents::streamCompressed(const char* obj_file, const mesh_callback &on_mesh, const progress_callback &on_progress)
+	{
+		compressed_reader reader(obj_file);
+
+		if (!reader.isOpen())
+		{
+			string error = "unable to open obj file: ";
+			error += obj_file;
+			std::cout << error << std::endl;
+			error_log.push_back(error);
+			return false;
+		}
+
+		if (on_progress && !on_progress(0, reader.getCompressedSize()))
+			return false;
+
+		obj_stream_state state(mesh_resource);
+		beginStream(state);
+
+		//a line split across two blocks is carried here until its end arrives
+		string partial_line;
+		string block;
+
+		while (reader.nextBlock(block))
+		{
+			const char* cursor = block.data();
+			const char* end = block.data() + block.size();
+
+			if (!partial_line.empty())
+			{
+				const char* line_end = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+
+				if (line_end == nullptr)
+				{
+					partial_line.append(cursor, end);
+					continue;
+				}
+
+				partial_line.append(cursor, line_end + 1);
+				cursor = line_end + 1;
+
+				const char* partial_cursor = partial_line.data();
+				streamLine(state, nextLine(partial_cursor, partial_line.data() + partial_line.size()), on_mesh);
+				partial_line.clear();
+			}
+
+			//only whole lines are parsed from the block, the rest waits for the next one
+			const char* complete_end = end;
+			while (complete_end != cursor && *(complete_end - 1) != '\n')
+				complete_end--;
+
+			while (cursor != complete_end)
+				streamLine(state, nextLine(cursor, complete_end), on_mesh);
+
+			partial_line.assign(complete_end, end);
+
+			if (on_progress && !on_progress(reader.getCompressedBytesRead(), reader.getCompressedSize()))
+				return false;
+		}
+
+		if (!partial_line.empty())
+		{
+			const char* partial_cursor = partial_line.data();
+			streamLine(state, nextLine(partial_cursor, partial_line.data() + partial_line.size()), on_mesh);
+		}
+
+		//whatever was parsed before the corruption is kept, like a plain file with bad lines
+		if (!reader.getError().empty())
+		{
+			std::cout << reader.getError() << std::endl;
+			error_log.push_back(reader.getError());
+		}
+
+		endStream(state, on_mesh);
 
-		return vector<glm::vec3> {tangent, bitangent};
+		if (on_progress)
+			on_progress(reader.getCompressedSize(), reader.getCompressedSize());
+
+		return reader.getError().empty();
 	}
 
-	void obj_contents::addRawData(const vector<float> &floats, DATA_TYPE dt)
+	//one pass that reads raw elements and records where each mesh lives, faces are validated but never built
+	void obj_contents::indexContents(const char* begin, const char* end)
 	{
-		switch (dt)
+		obj_parse_chunk chunk(createLineScratch(mesh_resource));
+		chunk.begin = begin;
+		chunk.end = end;
+		chunk.raw_data_presized = false;
+
+		raw_element_array* raw_data[RAW_DATA_SLOTS] = { &raw_v_data, &raw_vt_data, &raw_vn_data, &raw_vp_data };
+		for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
 		{
-		case OBJ_V:
-			raw_v_data[v_index_counter] = floats;
-			v_index_counter++;
-			break;
-		case OBJ_VT:
-			raw_vt_data[vt_index_counter] = floats;
-			vt_index_counter++;
-			break;
-		case OBJ_VN:
-			raw_vn_data[vn_index_counter] = floats;
-			vn_index_counter++;
-			break;
-		case OBJ_VP:
-			raw_vp_data[vp_index_counter] = floats;
-			vp_index_counter++;
-			break;
-		default: break;
+			chunk.raw_base[slot] = 0;
+			chunk.raw_count[slot] = 0;
+			chunk.defined[slot] = 0;
+			chunk.raw_data[slot] = raw_data[slot];
 		}
-	}
 
-	const vector<float> extractFloats(const string &s)
-	{
-		vector<float> separated;
-		string current_string = "";
-		for (int i = 0; i < s.size(); i++)
-		{
-			bool add_string = false;
-			if (s[i] == ' ')
-				add_string = true;
+		bool end_of_vertex_data = false;
+		string current_material;
+
+		//only carries the name and material applyRecord gives the open mesh
+		mesh_data mesh;
+
+		obj_group group = obj_group();
+		vector<face_index> face_corners;
+
+		const char* cursor = begin;
 
-			else current_string += s[i];
+		while (cursor != end)
+		{
+			const char* line_begin = cursor;
+			int defined_before[RAW_DATA_SLOTS];
+			std::copy(chunk.defined, chunk.defined + RAW_DATA_SLOTS, defined_before);
 
-			if (i == s.size() - 1 && current_string.size() > 0)
-				add_string = true;
+			tokenizeLine(chunk, nextLine(cursor, end), face_corners);
 
-			if (add_string)
+			for (const parse_record &record : chunk.records)
 			{
-				try
+				if (record.type == OBJ_F)
 				{
-					float toAdd = std::stof(current_string);
-					separated.push_back(toAdd);
+					for (int i = record.first; i < record.first + record.count; i++)
+					{
+						int v = chunk.corners[i].v;
+						group.first_v = (group.first_v == 0) ? v : std::min(group.first_v, v);
+						group.last_v = std::max(group.last_v, v);
+					}
+
+					group.face_count++;
 				}
 
-				catch (const std::out_of_range &oor) {}
-				catch (const std::invalid_argument &ia) {}
+				//the line opening a new mesh becomes the first line of its range
+				else if (applyRecord(chunk, record, mesh, end_of_vertex_data, current_material))
+				{
+					group.name = mesh.getMeshlName();
+					group.material = mesh.getMaterialName();
+					group.end_offset = line_begin - begin;
+					groups.push_back(group);
+
+					mesh = mesh_data();
+					mesh.setMaterialName(current_material);
 
-				current_string.clear();
+					group = obj_group();
+					group.begin_offset = line_begin - begin;
+					std::copy(defined_before, defined_before + RAW_DATA_SLOTS, group.raw_base);
+				}
 			}
+
+			chunk.records.clear();
+			chunk.corners.clear();
+			chunk.strings.clear();
+		}
+
+		group.name = mesh.getMeshlName();
+		group.material = mesh.getMaterialName();
+		group.end_offset = end - begin;
+		groups.push_back(group);
+	}
+
+	mesh_data obj_contents::loadGroup(int n) const
+	{
+		const obj_group &group = groups.at(n);
+
+		//raw elements were read by the index pass, retokenizing only counts them so relative indices still resolve
+		obj_parse_chunk chunk(mesh_resource);
+		chunk.begin = source_data + group.begin_offset;
+		chunk.end = source_data + group.end_offset;
+		chunk.raw_data_presized = false;
+
+		for (int slot = 0; slot < RAW_DATA_SLOTS; slot++)
+		{
+			chunk.raw_base[slot] = group.raw_base[slot];
+			chunk.raw_count[slot] = 0;
+			chunk.raw_data[slot] = nullptr;
+		}
+
+		tokenizeChunk(chunk);
+
+		mesh_data mesh(mesh_resource);
+		mesh.setMeshName(group.name);
+		mesh.setMaterialName(group.material);
+
+		//names, materials and errors were already taken from these lines by the index pass
+		for (const parse_record &record : chunk.records)
+		{
+			if (record.type == OBJ_F)
+				buildFace(mesh, array_view<face_index>(chunk.corners.data() + record.first, record.count));
+		}
+
+		mesh.setMeshData();
+		mesh.generateTangents();
+		return mesh;
+	}
+
+	vector<mesh_data> obj_contents::loadGroups(const vector<string> &names, int thread_count) const
+	{
+		vector<int> selected;
+		for (int i = 0; i < int(groups.size()); i++)
+		{
+			if (std::find(names.begin(), names.end(), groups[i].name) != names.end())
+				selected.push_back(i);
 		}
 
-		return separated;
+		//built in the mesh resource up front, so moving each result in doesn't copy it
+		vector<mesh_data> loaded;
+		loaded.reserve(selected.size());
+
+		for (std::size_t i = 0; i < selected.size(); i++)
+			loaded.push_back(mesh_data(mesh_resource));
+
+		runParallel(thread_count, selected.size(), [&](int i) { loaded[i] = loadGroup(selected[i]); });
+
+		return loaded;
 	}
 
-	const vector< vector<int> > extractFaceSequence(const string &s)
+	vector<mesh_data> obj_contents::takeMeshes()
 	{
-		vector< vector<int> > index_list;
+		vector<mesh_data> taken;
+		taken.swap(meshes);
 
-		vector<int> digits;
-		vector<int> sequence;
-		bool values_begin = false;
+		return taken;
+	}
 
-		for (int i = 0; i < s.size(); i++)
+	// added for gen art project, used to generate matrices from a pre-made model
+	vector<glm::vec4> obj_contents::getAllVerticesOfAllMeshes() const
+	{
+		vector<glm::vec4> all_vertices;
+		for (const mesh_data &mesh : meshes)
 		{
-			if (s[i] == '/')
+			for (const vertex_data &vertex : mesh.getVertices())
 			{
-				if (digits.size() == 0)
-				{
-					sequence.push_back(0);
-					continue;
-				}
+				all_vertices.push_back(vertex.xyzw);
+			}
+		}
 
-				float extracted = 0;
+		return all_vertices;
+	}
 
-				for (int n = 0; n < digits.size(); n++)
-				{
-					int nth = digits.size() - 1 - n;
-					float multiplier = pow(10.0f, float(nth));
-					float toAdd = digits[n] * multiplier;
-					extracted += toAdd;
-				}
+	void raw_element_array::add(const float* floats, int count)
+	{
+		values.resize(values.size() + stride, 0.0f);
+		element_sizes.push_back(0);
+		set(size(), floats, count);
+	}
+
+	void raw_element_array::set(int n, const float* floats, int count)
+	{
+		//vertex colors ("v x y z r g b") are not kept
+		if (stride == 4 && count > 4)
+			count = 3;
+
+		count = std::min(count, stride);
+
+		std::copy(floats, floats + count, values.begin() + (n - 1) * stride);
+		element_sizes[n - 1] = (unsigned char)count;
+	}
+
+	void raw_element_array::resize(int element_count)
+	{
+		values.resize(element_count * stride, 0.0f);
+		element_sizes.resize(element_count, 0);
+	}
+
+	void raw_element_array::reserve(int element_count)
+	{
+		values.reserve(element_count * stride);
+		element_sizes.reserve(element_count);
+	}
+
+	array_view<float> raw_element_array::at(int n) const
+	{
+		if (n < 1 || n > size())
+			throw std::out_of_range("undefined obj element index");
 
-				sequence.push_back(int(extracted));
+		return array_view<float>(&values[(n - 1) * stride], element_sizes[n - 1]);
+	}
+
+	int extractFloats(string_view s, float* values, int max_count)
+	{
+		int count = 0;
+		const char* cursor = s.data();
+		const char* end = s.data() + s.size();
 
-				//resets counters
-				digits.clear();
+		while (cursor != end && count < max_count)
+		{
+			//skip separators
+			if (*cursor == ' ' || *cursor == '\t')
+			{
+				cursor++;
+				continue;
 			}
 
-			else if (s[i] >= '0' && s[i] <= '9')
+			const char* token_end = cursor;
+			while (token_end != end && *token_end != ' ' && *token_end != '\t')
+				token_end++;
+
+			//from_chars does not accept an explicit positive sign
+			const char* number_begin = (*cursor == '+') ? cursor + 1 : cursor;
+
+			float value;
+			std::from_chars_result result = std::from_chars(number_begin, token_end, value);
+
+			//keywords ("v", "Kd", etc.) and out of range values are skipped
+			if (result.ec == std::errc())
+				values[count++] = value;
+
+			cursor = token_end;
+		}
+
+		return count;
+	}
+
+	const vector<float> extractFloats(string_view s)
+	{
+		float values[MAX_LINE_FLOATS];
+		int count = extractFloats(s, values, MAX_LINE_FLOATS);
+		return vector<float>(values, values + count);
+	}
+
+	//reads a signed integer at cursor, returns 0 if there are no digits
+	//values too long for an int saturate at +-INT_MAX, which no range check lets through
+	int extractIndex(const char* &cursor, const char* end)
+	{
+		bool negative = false;
+		if (cursor != end && (*cursor == '-' || *cursor == '+'))
+		{
+			negative = (*cursor == '-');
+			cursor++;
+		}
+
+		int value = 0;
+		while (cursor != end && *cursor >= '0' && *cursor <= '9')
+		{
+			int digit = *cursor - '0';
+			value = (value > (INT_MAX - digit) / 10) ? INT_MAX : (value * 10) + digit;
+			cursor++;
+		}
+
+		return negative ? -value : value;
+	}
+
+	//negative obj indices count back from the most recently defined element
+	//one reaching back past the first element resolves to -1, so it fails the range check rather than reading as omitted
+	int resolveIndex(int index, int defined_count)
+	{
+		if (index >= 0)
+			return index;
+
+		return -index > defined_count ? -1 : defined_count + 1 + index;
+	}
+
+	void extractFaceSequence(string_view s, vector<face_index> &indices, int v_count, int vt_count, int vn_count)
+	{
+		indices.clear();
+
+		const char* cursor = s.data();
+		const char* end = s.data() + s.size();
+
+		//skip the "f" keyword
+		while (cursor != end && *cursor != ' ' && *cursor != '\t')
+			cursor++;
+
+		while (cursor != end)
+		{
+			if (*cursor == ' ' || *cursor == '\t')
 			{
-				int char_int = '0';
-				char_int = s[i] - char_int;
-				digits.push_back(char_int);
+				cursor++;
+				continue;
 			}
 
-			//if space found or end of string
-			if ((s[i] == ' ' && values_begin) || i == s.size() - 1)
+			//each corner is v, v/vt, v//vn or v/vt/vn
+			face_index corner = { 0, 0, 0 };
+			corner.v = resolveIndex(extractIndex(cursor, end), v_count);
+
+			if (cursor != end && *cursor == '/')
 			{
-				float extracted = 0;
+				cursor++;
+				corner.vt = resolveIndex(extractIndex(cursor, end), vt_count);
 
-				for (int n = 0; n < digits.size(); n++)
+				if (cursor != end && *cursor == '/')
 				{
-					int nth = digits.size() - 1 - n;
-					float multiplier = pow(10.0f, float(nth));
-					float toAdd = digits[n] * multiplier;
-					extracted += toAdd;
+					cursor++;
+					corner.vn = resolveIndex(extractIndex(cursor, end), vn_count);
 				}
+			}
 
-				sequence.push_back(int(extracted));
-				index_list.push_back(sequence);
+			indices.push_back(corner);
 
-				//resets counters
-				sequence.clear();
-				digits.clear();
-			}
+			//ignore anything else left in a malformed token
+			while (cursor != end && *cursor != ' ' && *cursor != '\t')
+				cursor++;
+		}
+	}
+
+	string_view nextLine(const char* &cursor, const char* end)
+	{
+		const char* line_begin = cursor;
+		const char* line_end = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
 
-			else if (s[i] == ' ' && !values_begin)
-				values_begin = true;
+		if (line_end == nullptr)
+		{
+			line_end = end;
+			cursor = end;
 		}
 
-		return index_list;
+		else cursor = line_end + 1;
+
+		//files saved on windows end each line with "\r\n"
+		if (line_end != line_begin && *(line_end - 1) == '\r')
+			line_end--;
+
+		return string_view(line_begin, line_end - line_begin);
 	}
 
-	const string extractName(const string &line)
+	file_mapping::file_mapping(const char* file_path) : mapped_data(nullptr), mapped_size(0), open(false)
 	{
-		string name;
-		bool name_begin = false;
-		for (int i = 0; i < line.size(); i++)
+	#ifdef _WIN32
+		mapping_handle = nullptr;
+		file_handle = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (file_handle == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file_handle, &file_size))
+			return;
+
+		open = true;
+		mapped_size = std::size_t(file_size.QuadPart);
+
+		//empty files cannot be mapped, but are still valid files
+		if (mapped_size == 0)
+			return;
+
+		mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_handle != nullptr)
+			mapped_data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+
+		if (mapped_data == nullptr)
 		{
-			if (line[i] == ' ' && !name_begin)
-			{
-				name_begin = true;
-				continue;
-			}
+			open = false;
+			mapped_size = 0;
+		}
+	#else
+		file_descriptor = ::open(file_path, O_RDONLY);
+
+		if (file_descriptor < 0)
+			return;
+
+		struct stat file_stats;
+		if (fstat(file_descriptor, &file_stats) != 0)
+			return;
+
+		open = true;
+		mapped_size = std::size_t(file_stats.st_size);
 
-			else if (name_begin)
-				name += line[i];
+		//empty files cannot be mapped, but are still valid files
+		if (mapped_size == 0)
+			return;
+
+		void* mapped = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+		if (mapped == MAP_FAILED)
+		{
+			open = false;
+			mapped_size = 0;
+			return;
 		}
 
-		return name;
+		//the parser reads front to back, let the kernel read ahead aggressively
+		madvise(mapped, mapped_size, MADV_SEQUENTIAL);
+		mapped_data = static_cast<const char*>(mapped);
+	#endif
+	}
+
+	void file_mapping::release(std::size_t offset, std::size_t length) const
+	{
+	#ifndef _WIN32
+		//only whole pages inside the range can be dropped
+		std::size_t page_size = std::size_t(sysconf(_SC_PAGESIZE));
+		std::size_t first_page = ((offset + page_size - 1) / page_size) * page_size;
+		std::size_t last_page = ((offset + length) / page_size) * page_size;
+
+		if (mapped_data != nullptr && last_page > first_page)
+			madvise(const_cast<char*>(mapped_data) + first_page, last_page - first_page, MADV_DONTNEED);
+	#endif
+	}
+
+	file_mapping::~file_mapping()
+	{
+	#ifdef _WIN32
+		if (mapped_data != nullptr)
+			UnmapViewOfFile(mapped_data);
+
+		if (mapping_handle != nullptr)
+			CloseHandle(mapping_handle);
+
+		if (file_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(file_handle);
+	#else
+		if (mapped_data != nullptr)
+			munmap(const_cast<char*>(mapped_data), mapped_size);
+
+		if (file_descriptor >= 0)
+			close(file_descriptor);
+	#endif
+	}
+
+	const string extractName(string_view line)
+	{
+		return string(extractNameView(line));
+	}
+
+	//every keyword recognized in obj and mtl files, none are longer than 8 characters
+	struct data_type_keyword
+	{
+		const char* keyword;
+		DATA_TYPE type;
+	};
+
+	constexpr data_type_keyword DATA_TYPE_KEYWORDS[] = {
+		{ "mtllib", OBJ_MTLLIB }, { "v", OBJ_V }, { "vt", OBJ_VT }, { "vn", OBJ_VN }, { "vp", OBJ_VP },
+		{ "f", OBJ_F }, { "g", OBJ_G }, { "usemtl", OBJ_USEMTL },
+		{ "newmtl", MTL_NEWMTL }, { "Ka", MTL_KA }, { "Kd", MTL_KD }, { "Ks", MTL_KS }, { "Ns", MTL_NS },
+		{ "Tr", MTL_D }, { "d", MTL_D }, { "Tf", MTL_D },
+		{ "map_Ka", MTL_MAP_KA }, { "map_Kd", MTL_MAP_KD }, { "map_Ks", MTL_MAP_KS }, { "map_Ns", MTL_MAP_NS },
+		{ "map_d", MTL_MAP_D }, { "map_bump", MTL_MAP_BUMP }, { "bump", MTL_MAP_BUMP },
+		{ "disp", MTL_MAP_DISP }, { "decal", MTL_DECAL }
+	};
+
+	const int KEYWORD_SLOT_BITS = 7;
+	const int KEYWORD_SLOTS = 1 << KEYWORD_SLOT_BITS;
+
+	//packs up to 8 characters into one integer, so a keyword compares with a single instruction
+	constexpr unsigned long long packKeyword(const char* keyword)
+	{
+		unsigned long long key = 0;
+
+		for (int i = 0; keyword[i] != '\0'; i++)
+			key |= (unsigned long long)(unsigned char)keyword[i] << (8 * i);
+
+		return key;
 	}
 
-	const DATA_TYPE getDataType(const string &line)
+	constexpr int keywordSlot(unsigned long long key, unsigned long long multiplier)
 	{
-		string prefix;
-		for (int i = 0; i < line.size(); i++)
+		return int(((key ^ (key >> 29)) * multiplier) >> (64 - KEYWORD_SLOT_BITS));
+	}
+
+	constexpr bool keywordsCollide(unsigned long long multiplier)
+	{
+		bool used[KEYWORD_SLOTS] = {};
+
+		for (const auto &keyword : DATA_TYPE_KEYWORDS)
 		{
-			if (line[i] != ' ')
-				prefix += line[i];
+			int slot = keywordSlot(packKeyword(keyword.keyword), multiplier);
 
-			else break;
+			if (used[slot])
+				return true;
+
+			used[slot] = true;
 		}
 
-		if (prefix == "mtllib")
-			return OBJ_MTLLIB;
+		return false;
+	}
+
+	//walks a splitmix sequence until a multiplier sends every keyword to its own slot
+	constexpr unsigned long long findKeywordMultiplier()
+	{
+		unsigned long long seed = 0;
+
+		for (int i = 0; i < 4096; i++)
+		{
+			seed += 0x9E3779B97F4A7C15ULL;
+
+			unsigned long long multiplier = seed;
+			multiplier = (multiplier ^ (multiplier >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			multiplier = (multiplier ^ (multiplier >> 27)) * 0x94D049BB133111EBULL;
+			multiplier = (multiplier ^ (multiplier >> 31)) | 1;
+
+			if (!keywordsCollide(multiplier))
+				return multiplier;
+		}
 
-		if (prefix == "v")
-			return OBJ_V;
+		return 0;
+	}
 
-		if (prefix == "vt")
-			return OBJ_VT;
+	constexpr unsigned long long KEYWORD_MULTIPLIER = findKeywordMultiplier();
+	static_assert(KEYWORD_MULTIPLIER != 0, "no perfect hash found for the DATA_TYPE keywords");
 
-		if (prefix == "vn")
-			return OBJ_VN;
+	struct keyword_table
+	{
+		unsigned long long keys[KEYWORD_SLOTS];
+		DATA_TYPE types[KEYWORD_SLOTS];
+	};
 
-		if (prefix == "vp")
-			return OBJ_VP;
+	constexpr keyword_table buildKeywordTable()
+	{
+		keyword_table table = {};
 
-		if (prefix == "f")
-			return OBJ_F;
+		for (int i = 0; i < KEYWORD_SLOTS; i++)
+			table.types[i] = UNDEFINED_DATA_TYPE;
 
-		if (prefix == "g")
-			return OBJ_G;
+		for (const auto &keyword : DATA_TYPE_KEYWORDS)
+		{
+			unsigned long long key = packKeyword(keyword.keyword);
+			int slot = keywordSlot(key, KEYWORD_MULTIPLIER);
 
-		if (prefix == "usemtl")
-			return OBJ_USEMTL;
+			table.keys[slot] = key;
+			table.types[slot] = keyword.type;
+		}
 
-		if (prefix == "newmtl")
-			return MTL_NEWMTL;
+		return table;
+	}
 
-		if (prefix == "Ka")
-			return MTL_KA;
+	constexpr keyword_table KEYWORD_TABLE = buildKeywordTable();
 
-		if (prefix == "Kd")
-			return MTL_KD;
+	//classifies a line by its first word, one table probe and no allocation
+	const DATA_TYPE getDataType(string_view line)
+	{
+		unsigned long long key = 0;
 
-		if (prefix == "Ks")
-			return MTL_KS;
+		for (std::size_t i = 0; i < line.size() && line[i] != ' '; i++)
+		{
+			//longer than any keyword, or holding a character no keyword packs
+			if (i == 8 || line[i] == '\0')
+				return UNDEFINED_DATA_TYPE;
 
-		if (prefix == "Ns")
-			return MTL_NS;
+			key |= (unsigned long long)(unsigned char)line[i] << (8 * i);
+		}
 
-		if (prefix == "Tr" || prefix == "d" || prefix == "Tf")
-			return MTL_D;
+		int slot = keywordSlot(key, KEYWORD_MULTIPLIER);
+		return KEYWORD_TABLE.keys[slot] == key ? KEYWORD_TABLE.types[slot] : UNDEFINED_DATA_TYPE;
+	}
 
-		if (prefix == "map_Ka")
-			return MTL_MAP_KA;
+	vector<mesh_data> generateMeshes(const char* file_path, int thread_count, bool use_cache, int lod_levels)
+	{
+		string cache_path = mesh_cache::getCachePath(file_path);
+		vector<mesh_data> meshes;
 
-		if (prefix == "map_Kd")
-			return MTL_MAP_KD;
+		auto missingLODs = [lod_levels](const vector<mesh_data> &loaded) {
+			for (const mesh_data &mesh : loaded)
+			{
+				if (lod_levels > 0 && mesh.getLODs().empty() && mesh.getFaceCount() > 0)
+					return true;
+			}
 
-		if (prefix == "map_Ks")
-			return MTL_MAP_KS;
+			return false;
+		};
 
-		if (prefix == "map_Ns")
-			return MTL_MAP_NS;
+		bool cached = use_cache && mesh_cache::load(cache_path.c_str(), file_path, meshes);
+		if (cached && !missingLODs(meshes))
+			return meshes;
 
-		if (prefix == "map_d")
-			return MTL_MAP_D;
+		if (!cached)
+		{
+			obj_contents contents(file_path, thread_count);
+			meshes = contents.takeMeshes();
+		}
 
-		if (prefix == "map_bump" || prefix == "bump")
-			return MTL_MAP_BUMP;
+		if (lod_levels > 0)
+		{
+			if (thread_count == 0)
+				thread_count = std::max(1, int(std::thread::hardware_concurrency()));
 
-		if (prefix == "disp")
-			return MTL_MAP_DISP;
+			runParallel(thread_count, meshes.size(), [&meshes, lod_levels](int i) {
+				meshes[i].buildLODChain(lod_levels);
+			});
+		}
 
-		if (prefix == "decal")
-			return MTL_DECAL;
+		//stale or corrupt caches are simply overwritten, as are caches saved without the LODs asked for
+		mesh_cache_key key;
+		if (use_cache && meshes.size() > 0 && mesh_cache::getSourceKey(file_path, key, true))
+			mesh_cache::save(cache_path.c_str(), key, meshes);
 
-		return UNDEFINED_DATA_TYPE;
+		return meshes;
 	}
 
-	const vector<mesh_data> generateMeshes(const char* file_path)
+	void streamMeshes(const char* file_path, const mesh_callback &on_mesh)
 	{
-		obj_contents contents(file_path);
-		return contents.getMeshes();
+		obj_contents contents(file_path, on_mesh);
 	}
 
 	const map<string, boost::shared_ptr<material_data> > generateMaterials(const char* file_path, boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context)
@@ -994,67 +1953,157 @@ namespace jep
 
 	mtl_contents::mtl_contents(const char* mtl_file, boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context)
 	{
-		std::fstream file;
-		file.open(mtl_file, std::ifstream::in);
+		vector<material_description> descriptions;
+
+		if (parseMaterialDescriptions(mtl_file, descriptions, error_log))
+			materials = createMaterials(mtl_file, descriptions, textures, context, error_log);
+	}
+
+	bool parseMaterialDescriptions(const char* mtl_file, vector<material_description> &descriptions, vector<string> &errors)
+	{
+		boost::shared_ptr<file_mapping> file;
+		string decompressed;
+		array_view<char> text;
+		bool opened = false;
+
+		//mtl files are small, so compressed ones are decompressed whole before reading
+		if (compressed_reader::getCompression(mtl_file) != NO_COMPRESSION)
+		{
+			compressed_reader reader(mtl_file);
+			opened = reader.isOpen();
+
+			//an unopened file is reported below, like an uncompressed one
+			if (opened)
+			{
+				string block;
+				while (reader.nextBlock(block))
+					decompressed.append(block);
+
+				if (!reader.getError().empty())
+				{
+					std::cout << reader.getError() << std::endl;
+					errors.push_back(reader.getError());
+				}
+			}
+
+			text = array_view<char>(decompressed.data(), decompressed.size());
+		}
+
+		else
+		{
+			file = boost::shared_ptr<file_mapping>(new file_mapping(mtl_file));
+			text = file->getView();
+			opened = file->isOpen();
+		}
 
-		if (!file.is_open())
+		if (!opened)
 		{
 			string error = "unable to open mtl file: ";
 			error += mtl_file;
 			std::cout << error << std::endl;
-			error_log.push_back(error);
-			return;
+			errors.push_back(error);
+			return false;
 		}
 
-		bool data_set = false;
-
-		map<string, boost::shared_ptr<material_data> >::iterator current_material;
-
-		while (!file.eof())
+		const char* cursor = text.begin();
+		while (cursor != text.end())
 		{
-			string line;
-			std::getline(file, line, '\n');
-
+			string_view line = nextLine(cursor, text.end());
 			DATA_TYPE type = getDataType(line);
 
-			if (type == UNDEFINED_DATA_TYPE)
-				continue;
-
 			if (type == MTL_NEWMTL)
 			{
-				string mtl_name = extractName(line);
-				materials[mtl_name] = boost::shared_ptr<material_data>(new material_data(mtl_name, context, textures));
-				current_material = materials.find(mtl_name);
+				descriptions.push_back(material_description());
+				descriptions.back().name = extractName(line);
+				descriptions.back().bump_value = 0.0f;
+				descriptions.back().bump_value_set = false;
+				continue;
 			}
 
+			//lines before the first newmtl have no material to apply to
+			if (descriptions.empty())
+				continue;
+
+			material_description &material = descriptions.back();
+
 			if (type == MTL_KD || type == MTL_KA || type == MTL_D)
-			{
-				vector<float> floats(extractFloats(line));
-				current_material->second->setData(type, floats);
-			}
+				material.data[type] = extractFloats(line);
 
-			if (type == MTL_MAP_KD) {
-				string diffuse_filename = extractName(line);
-				string texture_handle = current_material->second->getMaterialName() + "_diffuse";
-				textures->addTextureByFilename(texture_handle, diffuse_filename);
-				current_material->second->setTextureData("diffuse", texture_handle);
-			}
+			if (type == MTL_MAP_KD)
+				material.diffuse_filename = extractName(line);
 
 			if (type == MTL_MAP_BUMP)
 			{
 				string bumpmap_string = extractName(line);
 				size_t filename_delimiter = bumpmap_string.find(" -bm ");
 
-				string bump_filename = bumpmap_string.substr(0, filename_delimiter);
-				string texture_handle = current_material->second->getMaterialName() + "_bump";
-				textures->addTextureByFilename(texture_handle, bump_filename);
-				current_material->second->setTextureData("bump", texture_handle);
+				material.bump_filename = bumpmap_string.substr(0, filename_delimiter);
+
+				if (filename_delimiter != string::npos)
+				{
+					string extracted_intensity = bumpmap_string.substr(filename_delimiter + 4);
+					material.bump_value = std::stof(extracted_intensity, 0);
+					material.bump_value_set = true;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	//texture_handler refuses a second texture from the same file, so materials sharing an image share its handle
+	//returns an empty handle, with the reason in errors, when the texture couldn't be added
+	string addSharedTexture(boost::shared_ptr<texture_handler> &textures, const string &texture_handle, const string &file_name, vector<string> &errors)
+	{
+		string existing_handle = textures->findTextureHandle(file_name);
+
+		if (!existing_handle.empty())
+			return existing_handle;
+
+		if (textures->addTextureByFilename(texture_handle, file_name) == nullptr)
+		{
+			errors.push_back("unable to add texture " + file_name + " as " + texture_handle);
+			return "";
+		}
+
+		return texture_handle;
+	}
+
+	const map<string, boost::shared_ptr<material_data> > createMaterials(const string &mtl_file, const vector<material_description> &descriptions,
+		boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context, vector<string> &errors)
+	{
+		map<string, boost::shared_ptr<material_data> > materials;
+
+		for (const material_description &description : descriptions)
+		{
+			boost::shared_ptr<material_data> material(new material_data(description.name, context, textures));
 
-				string extracted_intensity = bumpmap_string.substr(filename_delimiter + 4);
-				current_material->second->setBumpValue(std::stof(extracted_intensity, 0));
+			for (const auto &data_pair : description.data)
+				material->setData(data_pair.first, data_pair.second);
+
+			//material names are only unique within one mtl file
+			string handle_prefix = mtl_file + ":" + description.name;
+
+			if (!description.diffuse_filename.empty())
+			{
+				string handle = addSharedTexture(textures, handle_prefix + "_diffuse", description.diffuse_filename, errors);
+				if (!handle.empty())
+					material->setTextureData("diffuse", handle);
+			}
+
+			if (!description.bump_filename.empty())
+			{
+				string handle = addSharedTexture(textures, handle_prefix + "_bump", description.bump_filename, errors);
+				if (!handle.empty())
+					material->setTextureData("bump", handle);
 			}
+
+			if (description.bump_value_set)
+				material->setBumpValue(description.bump_value);
+
+			materials[description.name] = material;
 		}
 
-		file.close();
+		return materials;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,534 @@
+#include "ogl_tools.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace jep
+{
+	vector<synthetic_obj_params> getSyntheticObjCorpus()
+	{
+		const int face_counts[] = { 1000, 10000, 100000, 1000000, 10000000 };
+		const int faces_per_group = 2000;
+
+		vector<synthetic_obj_params> corpus;
+
+		for (int face_count : face_counts)
+		{
+			int group_count = std::max(1, face_count / faces_per_group);
+
+			corpus.push_back({ face_count, group_count, 3, true, true, 8, 1 });
+			corpus.push_back({ face_count, group_count, 3, false, false, 8, 2 });
+			corpus.push_back({ face_count, group_count, 4, true, true, 8, 3 });
+			//n-gons don't share corners, so fewer fit in a group of comparable vertex count
+			corpus.push_back({ face_count, std::max(1, face_count / (faces_per_group / 5)), 6, false, true, 8, 4 });
+
+			//many small groups, stresses mesh splitting rather than dedup
+			corpus.push_back({ face_count, std::max(1, face_count / 100), 4, true, true, 8, 5 });
+		}
+
+		return corpus;
+	}
+
+	void appendLine(string &obj, const char* prefix, float a, float b)
+	{
+		char line[64];
+		int length = snprintf(line, sizeof(line), "%s %.6f %.6f\n", prefix, a, b);
+		obj.append(line, length);
+	}
+
+	void appendLine(string &obj, const char* prefix, float a, float b, float c)
+	{
+		char line[96];
+		int length = snprintf(line, sizeof(line), "%s %.6f %.6f %.6f\n", prefix, a, b, c);
+		obj.append(line, length);
+	}
+
+	//writes one corner as v, v/vt, v//vn or v/vt/vn, every attribute shares the position's index
+	void appendCorner(string &obj, int index, bool with_vt, bool with_vn)
+	{
+		char corner[48];
+		int length;
+
+		if (with_vt && with_vn)
+			length = snprintf(corner, sizeof(corner), " %d/%d/%d", index, index, index);
+
+		else if (with_vt)
+			length = snprintf(corner, sizeof(corner), " %d/%d", index, index);
+
+		else if (with_vn)
+			length = snprintf(corner, sizeof(corner), " %d//%d", index, index);
+
+		else length = snprintf(corner, sizeof(corner), " %d", index);
+
+		obj.append(corner, length);
+	}
+
+	string generateSyntheticObj(const synthetic_obj_params &params, const string &mtl_filename)
+	{
+		std::mt19937 random(params.seed);
+		std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+
+		const int group_count = std::max(1, params.group_count);
+		const int corners = std::max(3, params.corners_per_face);
+		const float pi = 3.14159265f;
+
+		string obj = "# synthetic obj\n";
+		if (!mtl_filename.empty())
+			obj += "mtllib " + mtl_filename + "\n";
+
+		//every attribute is written once per vertex, so a vertex index addresses v, vt and vn alike
+		int vertex_base = 0;
+
+		for (int group = 0; group < group_count; group++)
+		{
+			int group_faces = params.face_count / group_count + (group < params.face_count % group_count ? 1 : 0);
+			float group_offset = float(group) * 2.0f;
+
+			vector<int> face_corners;
+
+			if (corners <= 4)
+			{
+				//a grid of cells, each cell is one quad or two triangles sharing its corners
+				int cell_count = (corners == 3) ? (group_faces + 1) / 2 : group_faces;
+				int columns = std::max(1, int(std::ceil(std::sqrt(float(cell_count)))));
+				int rows = std::max(1, (cell_count + columns - 1) / columns);
+
+				for (int y = 0; y <= rows; y++)
+				{
+					for (int x = 0; x <= columns; x++)
+					{
+						float u = float(x) / columns;
+						float v = float(y) / rows;
+
+						appendLine(obj, "v", group_offset + u, v, jitter(random));
+
+						if (params.with_vt)
+							appendLine(obj, "vt", u, v);
+
+						if (params.with_vn)
+							appendLine(obj, "vn", 0.0f, 0.0f, 1.0f);
+					}
+				}
+
+				int written = 0;
+				for (int cell = 0; cell < cell_count && written < group_faces; cell++)
+				{
+					int x = cell % columns;
+					int y = cell / columns;
+					int corner_00 = vertex_base + y * (columns + 1) + x + 1;
+					int corner_10 = corner_00 + 1;
+					int corner_01 = corner_00 + columns + 1;
+					int corner_11 = corner_01 + 1;
+
+					if (corners == 4)
+					{
+						face_corners.insert(face_corners.end(), { corner_00, corner_10, corner_11, corner_01 });
+						written++;
+						continue;
+					}
+
+					face_corners.insert(face_corners.end(), { corner_00, corner_10, corner_11 });
+					written++;
+
+					if (written < group_faces)
+					{
+						face_corners.insert(face_corners.end(), { corner_00, corner_11, corner_01 });
+						written++;
+					}
+				}
+
+				vertex_base += (columns + 1) * (rows + 1);
+			}
+
+			else
+			{
+				//n-gons don't share corners, each face is its own ring of vertices
+				int columns = std::max(1, int(std::ceil(std::sqrt(float(group_faces)))));
+
+				for (int face = 0; face < group_faces; face++)
+				{
+					float center_x = group_offset + float(face % columns) / columns;
+					float center_y = float(face / columns) / columns;
+					float radius = 0.4f / columns;
+
+					for (int corner = 0; corner < corners; corner++)
+					{
+						float angle = 2.0f * pi * corner / corners;
+						float u = 0.5f + 0.5f * std::cos(angle);
+						float v = 0.5f + 0.5f * std::sin(angle);
+
+						appendLine(obj, "v", center_x + radius * std::cos(angle), center_y + radius * std::sin(angle), jitter(random));
+
+						if (params.with_vt)
+							appendLine(obj, "vt", u, v);
+
+						if (params.with_vn)
+							appendLine(obj, "vn", 0.0f, 0.0f, 1.0f);
+
+						face_corners.push_back(vertex_base + corner + 1);
+					}
+
+					vertex_base += corners;
+				}
+			}
+
+			obj += "g group_" + std::to_string(group) + "\n";
+
+			if (params.material_count > 0)
+				obj += "usemtl m" + std::to_string(group % params.material_count) + "\n";
+
+			for (std::size_t i = 0; i < face_corners.size(); i += corners)
+			{
+				obj += "f";
+
+				for (int corner = 0; corner < corners; corner++)
+					appendCorner(obj, face_corners[i + corner], params.with_vt, params.with_vn);
+
+				obj += "\n";
+			}
+		}
+
+		return obj;
+	}
+
+	string generateSyntheticMtl(int material_count)
+	{
+		string mtl;
+
+		for (int i = 0; i < material_count; i++)
+		{
+			float shade = float(i + 1) / (material_count + 1);
+
+			mtl += "newmtl m" + std::to_string(i) + "\n";
+			appendLine(mtl, "Ka", 0.1f, 0.1f, 0.1f);
+			appendLine(mtl, "Kd", shade, 1.0f - shade, 0.5f);
+			mtl += "d 1.0\n\n";
+		}
+
+		return mtl;
+	}
+
+	//0 where the platform doesn't report it
+	std::size_t getPeakResidentBytes()
+	{
+	#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+
+		return 0;
+	#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+
+		#ifdef __APPLE__
+		return std::size_t(usage.ru_maxrss);
+		#else
+		return std::size_t(usage.ru_maxrss) * 1024;
+		#endif
+	#endif
+	}
+
+	//0 where the platform doesn't report it
+	std::size_t getResidentBytes()
+	{
+	#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.WorkingSetSize;
+
+		return 0;
+	#elif defined(__linux__)
+		//the second field of statm is the resident set, in pages
+		std::ifstream statm("/proc/self/statm");
+		unsigned long long total_pages = 0, resident_pages = 0;
+
+		if (!(statm >> total_pages >> resident_pages))
+			return 0;
+
+		return std::size_t(resident_pages) * std::size_t(sysconf(_SC_PAGESIZE));
+	#else
+		return 0;
+	#endif
+	}
+
+	//starts the peak resident set over from the current one, false where the platform can't
+	bool resetPeakResidentBytes()
+	{
+	#if defined(__linux__)
+		std::ofstream clear_refs("/proc/self/clear_refs");
+		clear_refs << "5";
+		clear_refs.close();
+		return !clear_refs.fail();
+	#else
+		return false;
+	#endif
+	}
+
+	string jsonEscape(const string &s)
+	{
+		string escaped;
+
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+
+			if ((unsigned char)c < 0x20)
+			{
+				char code[8];
+				snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+				escaped += code;
+				continue;
+			}
+
+			escaped += c;
+		}
+
+		return escaped;
+	}
+
+	string profileObjLoad(const char* obj_file, int thread_count)
+	{
+		//memory is measured as growth over what the process held before the load, so whatever ran earlier isn't counted
+		//where the peak can't be reset, the growth is taken from the resident set left once the load is done instead
+		std::size_t resident_before = getResidentBytes();
+		bool peak_reset = resetPeakResidentBytes();
+
+		//io is measured on its own by faulting in every page, later stages then read from memory
+		std::chrono::steady_clock::time_point io_start = std::chrono::steady_clock::now();
+
+		file_mapping file(obj_file);
+		if (!file.isOpen())
+			return "{\"file\": \"" + jsonEscape(obj_file) + "\", \"error\": \"unable to open obj file\"}";
+
+		volatile char page_sum = 0;
+		for (std::size_t offset = 0; offset < file.size(); offset += 4096)
+			page_sum += file.data()[offset];
+
+		double io_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - io_start).count();
+
+		//scratch counts what the per-face arenas absorbed, heap what the meshes and arenas still took from the heap
+		counting_resource heap_resource(std::pmr::new_delete_resource());
+
+		obj_parse_timings timings;
+		obj_contents contents(file.getView(), thread_count, &timings, &heap_resource);
+		vector<mesh_data> meshes = contents.takeMeshes();
+
+		std::size_t resident_after = peak_reset ? getPeakResidentBytes() : getResidentBytes();
+		std::size_t load_resident_bytes = resident_after > resident_before ? resident_after - resident_before : 0;
+
+		long long face_count = 0;
+		long long vertex_count = 0;
+
+		for (mesh_data &mesh : meshes)
+		{
+			face_count += mesh.getFaceCount();
+			vertex_count += mesh.getVertexCount();
+		}
+
+		//the optional cache optimization isn't part of the load, it is reported on its own
+		std::chrono::steady_clock::time_point optimize_start = std::chrono::steady_clock::now();
+		vertex_cache_stats cache_before = { 0, 0, 0 };
+		vertex_cache_stats cache_after = { 0, 0, 0 };
+
+		for (mesh_data &mesh : meshes)
+		{
+			vertex_cache_stats mesh_before, mesh_after;
+			mesh.optimizeVertexCache(VERTEX_CACHE_SIZE, &mesh_before, &mesh_after);
+
+			cache_before.misses += mesh_before.misses;
+			cache_before.triangle_count += mesh_before.triangle_count;
+			cache_before.vertex_count += mesh_before.vertex_count;
+			cache_after.misses += mesh_after.misses;
+			cache_after.triangle_count += mesh_after.triangle_count;
+			cache_after.vertex_count += mesh_after.vertex_count;
+		}
+
+		double optimize_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - optimize_start).count();
+
+		double total_seconds = io_seconds + timings.count_seconds + timings.tokenize_seconds + timings.merge_seconds + timings.build_seconds +
+			timings.tangent_seconds;
+		double megabytes = double(file.size()) / (1024.0 * 1024.0);
+
+		std::ostringstream report;
+		report << std::fixed << std::setprecision(6)
+			<< "{\"file\": \"" << jsonEscape(obj_file) << "\", \"bytes\": " << file.size() << ", \"threads\": " << thread_count
+			<< ", \"meshes\": " << meshes.size() << ", \"faces\": " << face_count << ", \"vertices\": " << vertex_count
+			<< ", \"stages\": {\"io\": " << io_seconds << ", \"count\": " << timings.count_seconds
+			<< ", \"tokenize\": " << timings.tokenize_seconds << ", \"merge\": " << timings.merge_seconds
+			<< ", \"build\": " << timings.build_seconds << ", \"face_resolution\": " << timings.face_resolution_seconds
+			<< ", \"dedup\": " << timings.mesh_assembly_seconds << ", \"tangents\": " << timings.tangent_seconds << "}"
+			<< ", \"allocations\": {\"scratch\": " << timings.scratch_allocations << ", \"heap\": " << heap_resource.getAllocationCount()
+			<< ", \"heap_bytes\": " << heap_resource.getAllocatedBytes() << "}"
+			<< std::setprecision(4)
+			<< ", \"vertex_cache\": {\"size\": " << VERTEX_CACHE_SIZE
+			<< ", \"acmr_before\": " << cache_before.getACMR() << ", \"atvr_before\": " << cache_before.getATVR()
+			<< ", \"acmr_after\": " << cache_after.getACMR() << ", \"atvr_after\": " << cache_after.getATVR()
+			<< ", \"seconds\": " << std::setprecision(6) << optimize_seconds << "}"
+			<< ", \"total_seconds\": " << total_seconds
+			<< ", \"mb_per_second\": " << std::setprecision(3) << (total_seconds > 0.0 ? megabytes / total_seconds : 0.0)
+			<< ", \"faces_per_second\": " << std::setprecision(1) << (total_seconds > 0.0 ? face_count / total_seconds : 0.0)
+			<< ", \"load_rss_bytes\": " << load_resident_bytes << ", \"load_rss_is_peak\": " << (peak_reset ? "true" : "false")
+			<< ", \"peak_rss_bytes\": " << getPeakResidentBytes() << "}";
+
+		return report.str();
+	}
+
+	//the parser extractFloats replaced, a string per token and std::stof, kept only as benchmarkFloatParsing's baseline
+	vector<float> extractFloatsWithStof(string_view s)
+	{
+		vector<float> separated;
+		string current_string = "";
+		for (std::size_t i = 0; i < s.size(); i++)
+		{
+			bool add_string = false;
+			if (s[i] == ' ')
+				add_string = true;
+
+			else current_string += s[i];
+
+			if (i == s.size() - 1 && current_string.size() > 0)
+				add_string = true;
+
+			if (add_string)
+			{
+				try
+				{
+					float toAdd = std::stof(current_string);
+					separated.push_back(toAdd);
+				}
+
+				catch (const std::out_of_range &) {}
+				catch (const std::invalid_argument &) {}
+
+				current_string.clear();
+			}
+		}
+
+		return separated;
+	}
+
+	string benchmarkFloatParsing(int line_count, int repetitions)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> coordinate(-1000.0f, 1000.0f);
+
+		string lines;
+		for (int i = 0; i < line_count; i++)
+			appendLine(lines, "v", coordinate(random), coordinate(random), coordinate(random));
+
+		const char* begin = lines.data();
+		const char* end = lines.data() + lines.size();
+
+		//both parsers sum what they read, so neither pass can be optimized away and their results can be compared
+		double stof_seconds = 0.0, from_chars_seconds = 0.0;
+		double stof_sum = 0.0, from_chars_sum = 0.0;
+
+		for (int repetition = 0; repetition < std::max(1, repetitions); repetition++)
+		{
+			double sum = 0.0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (const char* cursor = begin; cursor != end;)
+			{
+				for (float value : extractFloatsWithStof(nextLine(cursor, end)))
+					sum += value;
+			}
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			stof_seconds = repetition == 0 ? seconds : std::min(stof_seconds, seconds);
+			stof_sum = sum;
+
+			sum = 0.0;
+			start = std::chrono::steady_clock::now();
+
+			for (const char* cursor = begin; cursor != end;)
+			{
+				float values[MAX_LINE_FLOATS];
+				int count = extractFloats(nextLine(cursor, end), values, MAX_LINE_FLOATS);
+
+				for (int i = 0; i < count; i++)
+					sum += values[i];
+			}
+
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			from_chars_seconds = repetition == 0 ? seconds : std::min(from_chars_seconds, seconds);
+			from_chars_sum = sum;
+		}
+
+		double megabytes = double(lines.size()) / (1024.0 * 1024.0);
+
+		char report[512];
+		snprintf(report, sizeof(report),
+			"{\"lines\": %d, \"bytes\": %llu, \"stof_seconds\": %.6f, \"stof_mb_per_second\": %.3f, "
+			"\"from_chars_seconds\": %.6f, \"from_chars_mb_per_second\": %.3f, \"speedup\": %.2f, \"results_match\": %s}",
+			line_count, (unsigned long long)lines.size(),
+			stof_seconds, stof_seconds > 0.0 ? megabytes / stof_seconds : 0.0,
+			from_chars_seconds, from_chars_seconds > 0.0 ? megabytes / from_chars_seconds : 0.0,
+			from_chars_seconds > 0.0 ? stof_seconds / from_chars_seconds : 0.0,
+			stof_sum == from_chars_sum ? "true" : "false");
+
+		return report;
+	}
+
+	string profileSyntheticCorpus(const string &output_prefix, const vector<synthetic_obj_params> &corpus, int thread_count)
+	{
+		//every file is written before any is loaded, so generating the next one doesn't overlap a load
+		vector<string> obj_files;
+
+		for (std::size_t i = 0; i < corpus.size(); i++)
+		{
+			string obj_file = output_prefix + std::to_string(i) + ".obj";
+			string mtl_file = output_prefix + std::to_string(i) + ".mtl";
+
+			//the mtl is referenced by name, so it sits beside the obj
+			string mtl_name = mtl_file.substr(mtl_file.find_last_of("/\\") == string::npos ? 0 : mtl_file.find_last_of("/\\") + 1);
+
+			std::ofstream obj_out(obj_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			obj_out << generateSyntheticObj(corpus[i], mtl_name);
+			obj_out.close();
+
+			std::ofstream mtl_out(mtl_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			mtl_out << generateSyntheticMtl(corpus[i].material_count);
+			mtl_out.close();
+
+			obj_files.push_back(obj_file);
+		}
+
+		string reports = "[";
+
+		for (std::size_t i = 0; i < corpus.size(); i++)
+		{
+			std::ostringstream params;
+			params << "{\"face_count\": " << corpus[i].face_count << ", \"group_count\": " << corpus[i].group_count
+				<< ", \"corners_per_face\": " << corpus[i].corners_per_face
+				<< ", \"vt\": " << (corpus[i].with_vt ? "true" : "false") << ", \"vn\": " << (corpus[i].with_vn ? "true" : "false") << "}, ";
+
+			string report = profileObjLoad(obj_files[i].c_str(), thread_count);
+
+			//the corpus parameters lead each report
+			reports += (i == 0 ? "\n" : ",\n");
+			reports += "{\"params\": " + params.str() + report.substr(1);
+		}
+
+		reports += "\n]";
+		return reports;
+	}
+}
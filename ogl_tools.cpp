@@ -1,10 +1,11 @@
 #include "ogl_tools.h"
+#include <algorithm>
 
 namespace jep
 {
 	const bool floatsAreEqual(float first, float second)
 	{
-		return abs(second - first) < .00000001f;
+		return abs(second - first) < FLOAT_EQUALITY_TOLERANCE;
 	}
 
 	void errorCallback(int error, const char* description)
@@ -1161,9 +1162,110 @@ namespace jep
 		int vn_data_size)
 	{
 		index_count = indices.size();
-		vertex_count = vertex_data.size();
+		index_type = GL_UNSIGNED_SHORT;
 		mesh_material = material;
+		lods.push_back(lod_range{ 0, index_count, 0.0f });
+		bounds_center = glm::vec3(0.0f);
+		bounds_radius = 0.0f;
+		format = VERTEX_FLOAT;
+		position_transform = glm::mat4(1.0f);
 
+		int stride;
+		vector<vertex_attribute> attributes = getFloatAttributes(v_data_size, vt_data_size, vn_data_size, stride);
+		initializeBuffers(draw_type, indices.data(), sizeof(unsigned short), vertex_data.data(), vertex_data.size() * sizeof(float), stride, attributes);
+	}
+
+	ogl_data::ogl_data(const boost::shared_ptr<ogl_context> &context,
+		const boost::shared_ptr<material_data> &material,
+		GLenum draw_type,
+		const std::vector<unsigned int> &indices,
+		const std::vector<float> &vertex_data,
+		int v_data_size,
+		int vt_data_size,
+		int vn_data_size)
+	{
+		index_count = indices.size();
+		mesh_material = material;
+		lods.push_back(lod_range{ 0, index_count, 0.0f });
+		bounds_center = glm::vec3(0.0f);
+		bounds_radius = 0.0f;
+		format = VERTEX_FLOAT;
+		position_transform = glm::mat4(1.0f);
+
+		int stride;
+		vector<vertex_attribute> attributes = getFloatAttributes(v_data_size, vt_data_size, vn_data_size, stride);
+		initializeBuffers(draw_type, indices, vertex_data.data(), vertex_data.size() * sizeof(float), stride, attributes);
+	}
+
+	ogl_data::ogl_data(const boost::shared_ptr<ogl_context> &context,
+		const boost::shared_ptr<material_data> &material,
+		GLenum draw_type,
+		const mesh_data &mesh,
+		vertex_format format)
+	{
+		const vector<unsigned int> &element_index = mesh.getElementIndex();
+		vector<unsigned int> indices(element_index.begin(), element_index.end());
+		lods.push_back(lod_range{ 0, int(indices.size()), 0.0f });
+
+		for (const mesh_lod &lod : mesh.getLODs())
+		{
+			lods.push_back(lod_range{ int(indices.size()), int(lod.element_index.size()), lod.error });
+			indices.insert(indices.end(), lod.element_index.begin(), lod.element_index.end());
+		}
+
+		array_view<vertex_data> vertices = mesh.getVertices();
+		glm::vec3 bounds_min(0.0f), bounds_max(0.0f);
+
+		for (std::size_t i = 0; i < vertices.size(); i++)
+		{
+			glm::vec3 position(vertices[i].xyzw);
+			bounds_min = (i == 0) ? position : glm::min(bounds_min, position);
+			bounds_max = (i == 0) ? position : glm::max(bounds_max, position);
+		}
+
+		bounds_center = (bounds_min + bounds_max) * 0.5f;
+		bounds_radius = 0.0f;
+
+		for (const vertex_data &vertex : vertices)
+			bounds_radius = std::max(bounds_radius, glm::length(glm::vec3(vertex.xyzw) - bounds_center));
+
+		std::size_t meshlet_indices = 0;
+		for (const meshlet &cluster : mesh.getMeshlets())
+			meshlet_indices += cluster.index_count;
+
+		if (meshlet_indices == element_index.size())
+			meshlets = mesh.getMeshlets();
+
+		index_count = element_index.size();
+		mesh_material = material;
+		this->format = format;
+
+		if (format == VERTEX_FLOAT)
+		{
+			vector<float> vertex_data = mesh.getIndexedVertexData();
+			position_transform = glm::mat4(1.0f);
+
+			int stride;
+			vector<vertex_attribute> attributes = getFloatAttributes(mesh.getVSize(), mesh.getVTSize(), mesh.getVNSize(), stride);
+			initializeBuffers(draw_type, indices, vertex_data.data(), vertex_data.size() * sizeof(float), stride, attributes);
+			return;
+		}
+
+		packed_vertex_data packed = packVertices(mesh, format);
+		position_transform = packed.position_transform;
+
+		vector<vertex_attribute> attributes = {
+			{ 3, packed.position_type, packed.position_type == GL_SHORT ? GL_TRUE : GL_FALSE, int(offsetof(packed_vertex, position)) },
+			{ 2, packed.uv_type, packed.uv_type == GL_UNSIGNED_SHORT ? GL_TRUE : GL_FALSE, int(offsetof(packed_vertex, uv)) },
+			{ 2, GL_SHORT, GL_TRUE, int(offsetof(packed_vertex, normal)) },
+			{ 3, GL_SHORT, GL_TRUE, int(offsetof(packed_vertex, tangent)) }
+		};
+
+		initializeBuffers(draw_type, indices, packed.vertices.data(), packed.vertices.size() * sizeof(packed_vertex), sizeof(packed_vertex), attributes);
+	}
+
+	vector<ogl_data::vertex_attribute> ogl_data::getFloatAttributes(int v_data_size, int vt_data_size, int vn_data_size, int &stride)
+	{
 		int uv_offset = v_data_size * sizeof(float);
 		int normal_offset = uv_offset + (vt_data_size * sizeof(float));
 
@@ -1171,7 +1273,41 @@ namespace jep
 		int tangent_offset = normal_offset + (vn_data_size * sizeof(float));
 		int bitangent_offset = tangent_offset + (3 * sizeof(float));
 
-		int stride = bitangent_offset + (3 * sizeof(float));
+		stride = bitangent_offset + (3 * sizeof(float));
+
+		return vector<vertex_attribute> {
+			{ v_data_size, GL_FLOAT, GL_FALSE, 0 },
+			{ vt_data_size, GL_FLOAT, GL_FALSE, uv_offset },
+			{ vn_data_size, GL_FLOAT, GL_FALSE, normal_offset },
+			{ 3, GL_FLOAT, GL_FALSE, tangent_offset },
+			{ 3, GL_FLOAT, GL_FALSE, bitangent_offset }
+		};
+	}
+
+	void ogl_data::initializeBuffers(GLenum draw_type, const std::vector<unsigned int> &indices,
+		const void* vertex_data, std::size_t vertex_bytes, int stride, const vector<vertex_attribute> &attributes)
+	{
+		unsigned int max_index = 0;
+		for (unsigned int index : indices)
+			max_index = std::max(max_index, index);
+
+		index_type = getIndexTypeFor(std::size_t(max_index) + 1);
+
+		if (index_type == GL_UNSIGNED_SHORT)
+		{
+			//halves the index buffer, which is most meshes
+			vector<unsigned short> short_indices(indices.begin(), indices.end());
+			initializeBuffers(draw_type, short_indices.data(), sizeof(unsigned short), vertex_data, vertex_bytes, stride, attributes);
+		}
+
+		else initializeBuffers(draw_type, indices.data(), sizeof(unsigned int), vertex_data, vertex_bytes, stride, attributes);
+	}
+
+	void ogl_data::initializeBuffers(GLenum draw_type, const void* indices, std::size_t index_size,
+		const void* vertex_data, std::size_t vertex_bytes, int stride, const vector<vertex_attribute> &attributes)
+	{
+		attribute_count = attributes.size();
+		vertex_count = int(vertex_bytes / stride);
 
 		initializeGLuints();
 
@@ -1182,38 +1318,23 @@ namespace jep
 
 		glGenBuffers(1, VBO.get());
 		glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertex_data.size() * sizeof(float), &vertex_data[0], draw_type);
+		glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertex_data, draw_type);
 
 		glGenBuffers(1, IND.get());
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *IND);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], draw_type);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (lods.back().first_index + lods.back().index_count) * index_size, indices, draw_type);
 
 		//TODO revise so all data exists in one buffer
-		//position
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, v_data_size, GL_FLOAT, GL_FALSE, stride, (void*)0);
-
-		//uv
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, vt_data_size, GL_FLOAT, GL_FALSE, stride, (void*)(uv_offset));
-
-		//normals
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, vn_data_size, GL_FLOAT, GL_FALSE, stride, (void*)(normal_offset));
-
-		//tangents
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(tangent_offset));
-
-		//bitangents
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)(bitangent_offset));
+		//position, uv, normal, tangent, then bitangent when it isn't rebuilt in the shader
+		for (int i = 0; i < attribute_count; i++)
+		{
+			const vertex_attribute &attribute = attributes[i];
+			glEnableVertexAttribArray(i);
+			glVertexAttribPointer(i, attribute.size, attribute.type, attribute.normalized, stride, (void*)(std::size_t)(attribute.offset));
+		}
 
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-		glDisableVertexAttribArray(3);
-		glDisableVertexAttribArray(4);
+		for (int i = 0; i < attribute_count; i++)
+			glDisableVertexAttribArray(i);
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -1230,33 +1351,149 @@ namespace jep
 			glDeleteBuffers(1, IND.get());
 	}
 
+	int ogl_data::selectLOD(const glm::mat4 &model_view, const glm::mat4 &projection, int viewport_height, float max_pixel_error) const
+	{
+		if (lods.size() < 2 || max_pixel_error <= 0.0f)
+			return 0;
+
+		//errors are in model units, the model view matrix may scale them
+		float scale = std::max(glm::length(glm::vec3(model_view[0])),
+			std::max(glm::length(glm::vec3(model_view[1])), glm::length(glm::vec3(model_view[2]))));
+
+		//pixels covered by one unit at the nearest point of the bounding sphere, an orthographic projection has no falloff
+		float pixels_per_unit = projection[1][1] * viewport_height * 0.5f;
+		bool perspective = projection[2][3] != 0.0f;
+
+		if (perspective)
+		{
+			float distance = -(model_view * glm::vec4(bounds_center, 1.0f)).z - bounds_radius * scale;
+
+			if (distance <= 0.0f)
+				return 0;
+
+			pixels_per_unit /= distance;
+		}
+
+		//errors only grow along the chain
+		int selected = 0;
+		for (int i = 1; i < int(lods.size()); i++)
+		{
+			if (lods[i].error * scale * pixels_per_unit > max_pixel_error)
+				break;
+
+			selected = i;
+		}
+
+		return selected;
+	}
+
+	bool ogl_data::cullMeshlets(const glm::mat4 &model_view, const glm::mat4 &projection, bool cull_back_faces,
+		vector<GLsizei> &counts, vector<const void*> &offsets) const
+	{
+		if (meshlets.empty())
+			return false;
+
+		//frustum planes in model space, taken from the rows of the combined matrix (Gribb and Hartmann)
+		glm::mat4 clip = projection * model_view;
+		glm::vec4 planes[6];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (int side = 0; side < 2; side++)
+			{
+				glm::vec4 &plane = planes[axis * 2 + side];
+				float sign = side == 0 ? 1.0f : -1.0f;
+
+				for (int column = 0; column < 4; column++)
+					plane[column] = clip[column][3] + sign * clip[column][axis];
+
+				float length = glm::length(glm::vec3(plane));
+				if (length > 0.0f)
+					plane /= length;
+			}
+		}
+
+		glm::vec3 camera_position(glm::inverse(model_view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		std::size_t index_size = getIndexSize();
+		unsigned int range_end = 0;
+
+		for (const meshlet &cluster : meshlets)
+		{
+			bool visible = true;
+
+			for (const glm::vec4 &plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), cluster.center) + plane.w < -cluster.radius)
+				{
+					visible = false;
+					break;
+				}
+			}
+
+			if (!visible)
+				continue;
+
+			glm::vec3 to_center = cluster.center - camera_position;
+			if (cull_back_faces && glm::dot(to_center, cluster.cone_axis) >= cluster.cone_cutoff * glm::length(to_center) + cluster.radius)
+				continue;
+
+			//meshlets are stored back to back, one that starts where the last range ended extends it
+			if (!counts.empty() && cluster.first_index == range_end)
+				counts.back() += cluster.index_count;
+
+			else
+			{
+				counts.push_back(cluster.index_count);
+				offsets.push_back((const void*)(std::size_t(cluster.first_index) * index_size));
+			}
+
+			range_end = cluster.first_index + cluster.index_count;
+		}
+
+		return true;
+	}
+
 	void ogl_model::draw(boost::shared_ptr<ogl_camera> &camera)
 	{
+		glm::mat4 model_view = camera->getViewMatrix() * model_matrix;
+		//with face culling off both sides of every face are drawn, so clusters facing away are still visible
+		bool cull_back_faces = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+
 		for (auto mesh : model_data)
 		{
 			glBindVertexArray(*(mesh->getVAO()));
-			glEnableVertexAttribArray(0);
-			glEnableVertexAttribArray(1);
-			glEnableVertexAttribArray(2);
-			glEnableVertexAttribArray(3);
-			glEnableVertexAttribArray(4);
+			for (int i = 0; i < mesh->getAttributeCount(); i++)
+				glEnableVertexAttribArray(i);
 
 			mesh->getMaterial()->setShader();
 
 			//TODO try removing this line
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *(mesh->getIND()));
 
-			camera->setMVP(context, model_matrix, jep::NORMAL);
+			//quantized positions are scaled back up on the gpu, lod and meshlet bounds are already in model space
+			camera->setMVP(context, model_matrix * mesh->getPositionTransform(), jep::NORMAL);
 
 			//glDrawArrays(GL_TRIANGLES, 0, opengl_data->getVertexCount());
-			glDrawElements(GL_TRIANGLES, mesh->getIndexCount(), GL_UNSIGNED_SHORT, (void*)0);
+			int lod = mesh->selectLOD(model_view, camera->getProjectionMatrix(), context->getWindowHeight(), lod_pixel_error);
+			draw_counts.clear();
+			draw_offsets.clear();
+
+			if (lod == 0 && mesh->cullMeshlets(model_view, camera->getProjectionMatrix(), cull_back_faces, draw_counts, draw_offsets))
+			{
+				if (!draw_counts.empty())
+					glMultiDrawElements(GL_TRIANGLES, draw_counts.data(), mesh->getIndexType(), draw_offsets.data(), GLsizei(draw_counts.size()));
+			}
+
+			else
+			{
+				const lod_range &range = mesh->getLODs()[lod];
+				glDrawElements(GL_TRIANGLES, range.index_count, mesh->getIndexType(), (void*)(std::size_t(range.first_index) * mesh->getIndexSize()));
+			}
 			glBindTexture(GL_TEXTURE_2D, 0);
 
-			glDisableVertexAttribArray(0);
-			glDisableVertexAttribArray(1);
-			glDisableVertexAttribArray(2);
-			glDisableVertexAttribArray(3);
-			glDisableVertexAttribArray(4);
+			for (int i = 0; i < mesh->getAttributeCount(); i++)
+				glDisableVertexAttribArray(i);
+
 			glBindVertexArray(0);
 		}
 	}
@@ -1634,6 +1871,16 @@ namespace jep
 		return map_gluints.at(texture_handle);
 	}
 
+	const string texture_handler::findTextureHandle(const string &file_name) const
+	{
+		string full_path = default_file_path + "\\" + file_name;
+
+		if (map_paths.find(full_path) == map_paths.end())
+			return "";
+
+		return map_paths.at(full_path);
+	}
+
 	boost::shared_ptr<GLuint> texture_handler::getTexture(const string &name)
 	{
 		if (map_gluints.find(name) == map_gluints.end())
@@ -4,16 +4,28 @@
 #include <GL\glew.h>
 #include <GLFW\glfw3.h>
 #include <string>
+#include <string_view>
+#include <cstddef>
 #include <glm.hpp>
 #include <gtc/matrix_transform.hpp>
 #include <vector>
 #include <map>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory_resource>
+#include <exception>
 #include <boost/shared_ptr.hpp>
 
 using std::vector;
 using std::string;
+using std::string_view;
 using std::map;
 using std::cout;
 using std::endl;
@@ -40,8 +52,26 @@ namespace jep
 	class mesh_data;
 	class obj_contents;
 	class ogl_context_exception;
+	class file_mapping;
+	class raw_element_array;
+	struct obj_parse_chunk;
+	struct parse_record;
+	struct obj_group;
+	struct obj_parse_timings;
+	struct obj_stream_state;
+	class compressed_reader;
+	class task_pool;
+	struct material_description;
+	struct loaded_model;
+	class mesh_cache;
+	class mesh_loader;
 	enum text_justification { LL, UL, UR, LR };
 	enum render_type { NORMAL, TEXT, ABSOLUTE, UNDEFINED_RENDER_TYPE };
+	enum obj_load_mode { OBJ_LOAD_ALL, OBJ_LOAD_INDEX };
+	enum compression_type { NO_COMPRESSION, GZIP_COMPRESSION, ZSTD_COMPRESSION };
+	//layout of the vertex buffer ogl_data uploads for a mesh_data, VERTEX_FLOAT is 56 bytes of 32-bit floats per vertex
+	//the packed layouts are 24 bytes, positions as half floats or snorm16 within the mesh bounds, see packed_vertex
+	enum vertex_format { VERTEX_FLOAT, VERTEX_PACKED_HALF, VERTEX_PACKED_SNORM16 };
 
 	const float getLineAngle(glm::vec2 first, glm::vec2 second, bool right_handed);
 	const glm::vec4 rotatePointAroundOrigin(const glm::vec4 &point, const glm::vec4 &origin, const float degrees, const glm::vec3 &axis);
@@ -50,14 +80,143 @@ namespace jep
 	void loadTGA(const char* imagepath, GLuint &textureID);
 	void errorCallback(int error, const char* description);
 
-	const vector<float> extractFloats(const string &s);
-	const vector< vector<int> > extractFaceSequence(const string &s);
-	const vector<mesh_data> generateMeshes(const char* file_path);
+	//most floats a single obj/mtl line carries, "v x y z r g b" is the longest common form
+	const int MAX_LINE_FLOATS = 8;
+
+	//parses whitespace-separated floats in s into values without allocating, tokens that aren't numbers are skipped
+	//returns the number of floats written, which never exceeds max_count
+	int extractFloats(string_view s, float* values, int max_count);
+	const vector<float> extractFloats(string_view s);
+
+	//one corner of an obj face, indices are 1-based and 0 where the attribute is omitted
+	struct face_index
+	{
+		int v;
+		int vt;
+		int vn;
+	};
+
+	//parses an "f" line into indices without per-face allocation, indices is cleared first so its capacity is reused
+	//negative (relative) indices are resolved against the number of elements defined so far
+	void extractFaceSequence(string_view s, vector<face_index> &indices, int v_count, int vt_count, int vn_count);
+	//receives each mesh as soon as it is complete, the mesh is discarded once the callback returns so it may be moved from
+	typedef std::function<void(mesh_data &mesh)> mesh_callback;
+	//receives how far a streaming parse has read, returning false stops the parse
+	typedef std::function<bool(std::size_t bytes_parsed, std::size_t bytes_total)> progress_callback;
+
+	//when use_cache is set, meshes are loaded from (or saved to) a binary cache beside the obj file
+	//lod_levels > 0 builds a LOD chain for every mesh, which is cached with it
+	vector<mesh_data> generateMeshes(const char* file_path, int thread_count = 1, bool use_cache = true, int lod_levels = 0);
+	void streamMeshes(const char* file_path, const mesh_callback &on_mesh);
 	const map<string, boost::shared_ptr<material_data> > generateMaterials(const char* file_path, boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context);
-	const DATA_TYPE getDataType(const string &line);
-	const string extractName(const string &line);
+	//reads an mtl file without touching GL, so it can run on any thread, problems are appended to errors
+	bool parseMaterialDescriptions(const char* mtl_file, vector<material_description> &descriptions, vector<string> &errors);
+	//creates the GL textures and materials described, call from the thread owning the context
+	//a texture already loaded from the same image file is reused instead of loaded again
+	//texture handles include mtl_file, so same-named materials from different mtl files keep their own images
+	//textures that fail to load are left off their material and reported in errors
+	const map<string, boost::shared_ptr<material_data> > createMaterials(const string &mtl_file, const vector<material_description> &descriptions,
+		boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context, vector<string> &errors);
+	//parses every obj file, and each mtl file they name once, concurrently on a task_pool (0 threads uses every core)
+	//materials are then created on the calling thread, which must own the context, models in the same order as obj_files
+	vector<loaded_model> loadModelBatch(const vector<string> &obj_files, boost::shared_ptr<texture_handler> &textures, const boost::shared_ptr<ogl_context> &context, int thread_count = 0);
+	const DATA_TYPE getDataType(string_view line);
+	const string extractName(string_view line);
+	//floats closer than this are treated as equal by floatsAreEqual
+	const float FLOAT_EQUALITY_TOLERANCE = .00000001f;
 	const bool floatsAreEqual(float first, float second);
 
+	//returns the next line in [cursor, end) without its line terminator, advances cursor past it
+	string_view nextLine(const char* &cursor, const char* end);
+
+	//runs task(0) ... task(task_count - 1), spread across up to thread_count threads
+	void runParallel(int thread_count, int task_count, const std::function<void(int)> &task);
+
+	//shape of a generated obj file, so load performance can be measured on reproducible input
+	struct synthetic_obj_params
+	{
+		int face_count;
+		int group_count;
+		//3 writes triangles, 4 quads and anything higher n-gons
+		int corners_per_face;
+		bool with_vt;
+		bool with_vn;
+		int material_count;
+		unsigned int seed;
+	};
+
+	//1K to 10M faces, each size as triangles, quads and n-gons with and without vt/vn, plus a many-group variant
+	//groups are kept to a few thousand vertices, the size of a typical mesh in a real scene
+	vector<synthetic_obj_params> getSyntheticObjCorpus();
+	//each group writes its v/vt/vn lines, then "g", "usemtl" and its faces, materials are named m0, m1 ...
+	string generateSyntheticObj(const synthetic_obj_params &params, const string &mtl_filename);
+	string generateSyntheticMtl(int material_count);
+
+	//loads obj_file stage by stage (io, count, tokenize, merge, face resolution, dedup, tangents)
+	//and returns the timings, throughput, allocation counts and resident memory as a json object,
+	//along with the vertex cache miss ratios before and after mesh_data::optimizeVertexCache
+	//load_rss_bytes is how far the resident set grew during the load, its peak where the platform lets that be reset,
+	//peak_rss_bytes is the process-wide high-water mark
+	string profileObjLoad(const char* obj_file, int thread_count = 1);
+	//times extractFloats against the std::stof based parser it replaced on the same line_count random "v x y z" lines,
+	//best of repetitions, and returns the throughput of each as a json object
+	string benchmarkFloatParsing(int line_count = 1000000, int repetitions = 5);
+	//writes every corpus entry as <output_prefix><n>.obj/.mtl, then profiles each and returns a json array of the reports
+	string profileSyntheticCorpus(const string &output_prefix, const vector<synthetic_obj_params> &corpus, int thread_count = 1);
+
+	//non-owning view of contiguous data, used to hand out buffers without copying them
+	template <typename T>
+	class array_view
+	{
+	public:
+		array_view() : first(nullptr), count(0) {}
+		array_view(const T* data, std::size_t size) : first(data), count(size) {}
+		template <typename Allocator>
+		array_view(const std::vector<T, Allocator> &data) : first(data.data()), count(data.size()) {}
+
+		const T* data() const { return first; }
+		std::size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		const T* begin() const { return first; }
+		const T* end() const { return first + count; }
+		const T& operator [] (std::size_t n) const { return first[n]; }
+
+	private:
+		const T* first;
+		std::size_t count;
+	};
+
+	//forwards to upstream, counting every allocation made through it, safe to share between threads
+	class counting_resource : public std::pmr::memory_resource
+	{
+	public:
+		counting_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+			upstream_resource(upstream), allocation_count(0), allocated_bytes(0) {}
+
+		unsigned long long getAllocationCount() const { return allocation_count; }
+		unsigned long long getAllocatedBytes() const { return allocated_bytes; }
+
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			allocation_count++;
+			allocated_bytes += bytes;
+			return upstream_resource->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			upstream_resource->deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+		std::pmr::memory_resource* upstream_resource;
+		std::atomic<unsigned long long> allocation_count;
+		std::atomic<unsigned long long> allocated_bytes;
+	};
+
 	//ogl_context initializes glew, creates a glfw window, generates programs using shaders provided, 
 	//and stores program and texture GLuints to be used by other objects
 	class ogl_context
@@ -435,6 +594,40 @@ namespace jep
 		boost::shared_ptr<ogl_context> context;
 	};
 
+	//narrowest element type that can index vertex_count vertices, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	//8-bit indices aren't used, many drivers widen them on the cpu at draw time
+	inline GLenum getIndexTypeFor(std::size_t vertex_count) { return vertex_count <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
+	//64 vertices and 124 triangles fit the usual mesh shader output limits
+	const int MESHLET_MAX_VERTICES = 64;
+	const int MESHLET_MAX_TRIANGLES = 124;
+
+	//a cluster of neighbouring triangles, element_index[first_index, first_index + index_count), culled as a whole
+	struct meshlet
+	{
+		unsigned int first_index;
+		unsigned int index_count;
+		//unique vertices its triangles use
+		unsigned int vertex_count;
+
+		glm::vec3 center;
+		float radius;
+
+		//every triangle normal lies within the cone around cone_axis, cone_cutoff is the sine of its half angle
+		//the cluster faces away from a viewer at p when dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius
+		//1 when the cone is too wide to ever face away
+		glm::vec3 cone_axis;
+		float cone_cutoff;
+	};
+
+	//one level of detail within an ogl_data index buffer, error is how far (in model units) it strays from the full mesh
+	struct lod_range
+	{
+		int first_index;
+		int index_count;
+		float error;
+	};
+
 	//class that handles VBO/VAO data for meshes that share a texture map
 	class ogl_data
 	{
@@ -447,10 +640,50 @@ namespace jep
 			int v_data_size,
 			int vt_data_size,
 			int vn_data_size);
+		//the index buffer is uploaded as 16-bit whenever every index fits, 32-bit otherwise
+		ogl_data(const boost::shared_ptr<ogl_context> &context,
+			const boost::shared_ptr<material_data> &material,
+			GLenum draw_type,
+			const std::vector<unsigned int> &indices,
+			const std::vector<float> &vertex_data,
+			int v_data_size,
+			int vt_data_size,
+			int vn_data_size);
+		//uploads the mesh's indexed vertices, its element_index and every level of its LOD chain after it
+		//meshlets covering the whole of element_index are kept for culling
+		//packed formats upload 4 attributes instead of 5, attribute 2 is the octahedral normal, attribute 3 the octahedral tangent
+		//with its handedness in z, the shader decodes both and rebuilds the bitangent as cross(normal, tangent) * handedness
+		ogl_data(const boost::shared_ptr<ogl_context> &context,
+			const boost::shared_ptr<material_data> &material,
+			GLenum draw_type,
+			const mesh_data &mesh,
+			vertex_format format = VERTEX_FLOAT);
 		~ogl_data();
 
+		//vertices in the vertex buffer, whatever the format
 		const int getVertexCount() const { return vertex_count; }
 		const int getIndexCount() const { return index_count; }
+		//element type of the index buffer, as passed to glDrawElements
+		const GLenum getIndexType() const { return index_type; }
+		const int getIndexSize() const { return index_type == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(unsigned short); }
+
+		const vertex_format getVertexFormat() const { return format; }
+		//vertex attributes 0 to getAttributeCount() - 1 are set up in the VAO
+		const int getAttributeCount() const { return attribute_count; }
+		//maps the positions in the vertex buffer back to model space, identity unless they were quantized
+		const glm::mat4 getPositionTransform() const { return position_transform; }
+
+		//lod 0 is the full mesh, coarser levels follow with growing error
+		const vector<lod_range>& getLODs() const { return lods; }
+		//coarsest level whose error, projected to the screen, stays within max_pixel_error pixels
+		int selectLOD(const glm::mat4 &model_view, const glm::mat4 &projection, int viewport_height, float max_pixel_error) const;
+
+		const vector<meshlet>& getMeshlets() const { return meshlets; }
+		//appends the index ranges of lod 0 left after dropping meshlets outside the frustum, and facing away when cull_back_faces is set,
+		//neighbouring survivors are merged into one range, returns false (leaving counts and offsets alone) without meshlets
+		//meshlets facing away are only invisible when back faces are culled, otherwise their back sides are drawn
+		bool cullMeshlets(const glm::mat4 &model_view, const glm::mat4 &projection, bool cull_back_faces,
+			vector<GLsizei> &counts, vector<const void*> &offsets) const;
 
 		boost::shared_ptr<GLuint> getVBO() const { return VBO; }
 		boost::shared_ptr<GLuint> getVAO() const { return VAO; }
@@ -470,14 +703,43 @@ namespace jep
 			IND = boost::shared_ptr<GLuint>(new GLuint);
 		}
 
+		//one glVertexAttribPointer, offset in bytes from the start of a vertex
+		struct vertex_attribute
+		{
+			GLint size;
+			GLenum type;
+			GLboolean normalized;
+			int offset;
+		};
+
+		//position, uv, normal, tangent and bitangent as floats, the tangents always vec3's
+		static vector<vertex_attribute> getFloatAttributes(int v_data_size, int vt_data_size, int vn_data_size, int &stride);
+
+		void initializeBuffers(GLenum draw_type, const void* indices, std::size_t index_size,
+			const void* vertex_data, std::size_t vertex_bytes, int stride, const vector<vertex_attribute> &attributes);
+		//uploads 32-bit indices as 16-bit when every one of them fits
+		void initializeBuffers(GLenum draw_type, const std::vector<unsigned int> &indices,
+			const void* vertex_data, std::size_t vertex_bytes, int stride, const vector<vertex_attribute> &attributes);
+
 		boost::shared_ptr<GLuint> VBO;
 		boost::shared_ptr<GLuint> VAO;
 		boost::shared_ptr<GLuint> IND;
 		
 		bool element_array_enabled;
-		unsigned short index_count;
+		int index_count;
+		GLenum index_type;
 		int vertex_count;
 
+		vertex_format format;
+		int attribute_count;
+		glm::mat4 position_transform;
+
+		vector<lod_range> lods;
+		vector<meshlet> meshlets;
+		//bounding sphere of the mesh, lod selection measures distance to it
+		glm::vec3 bounds_center;
+		float bounds_radius;
+
 		boost::shared_ptr<material_data> mesh_material;
 	};
 
@@ -488,15 +750,25 @@ namespace jep
 		ogl_model(const boost::shared_ptr<ogl_context> &existing_context) { context = existing_context; }
 		~ogl_model() {};
 
+		//each mesh is drawn at the coarsest level of detail within the pixel error allowed,
+		//at full detail only its meshlets inside the frustum and facing the camera are drawn
 		virtual void draw(boost::shared_ptr<ogl_camera> &camera);
 		boost::shared_ptr<ogl_data> getOGLData() { return opengl_data; }
 		glm::mat4 getModelMatrix() const { return model_matrix; }
 		void addData(const boost::shared_ptr<ogl_data> &toAdd) { model_data.push_back(toAdd); }
 
+		//0 always draws the full meshes
+		void setLODPixelError(float pixels) { lod_pixel_error = pixels; }
+		const float getLODPixelError() const { return lod_pixel_error; }
+
 	private:
 		boost::shared_ptr<ogl_data> opengl_data;
 		glm::mat4 model_matrix = glm::mat4(1.0);
 		boost::shared_ptr<ogl_context> context;
+		float lod_pixel_error = 1.0f;
+		//index ranges of the visible meshlets, kept so drawing doesn't allocate every frame
+		vector<GLsizei> draw_counts;
+		vector<const void*> draw_offsets;
 
 		vector < boost::shared_ptr<ogl_data> > model_data;
 	};
@@ -682,6 +954,8 @@ namespace jep
 		boost::shared_ptr<GLuint> addTextureByFilename(const string &texture_handle, const string &file_name);
 		boost::shared_ptr<GLuint> addTextureByPath(const string &texture_handle, const string &file_path);
 		boost::shared_ptr<GLuint> getTexture(const string &texture_handle);
+		//handle of the texture already loaded from file_name, empty if there is none
+		const string findTextureHandle(const string &file_name) const;
 
 		void addTextureUnloaded(const string &file_name, const string &file_path);
 		void addTextureUnloaded(const string &file_name);
@@ -737,78 +1011,155 @@ namespace jep
 		glm::vec4 color;
 	};
 
+	//position, uv and normal of one face corner, fixed size and trivially copyable so vertex tables are
+	//flat arrays that copy, cache and upload without a heap block per vertex
+	//attributes the obj file left out are flagged absent in the attribute mask, w defaults to 1
 	class vertex_data
 	{
 	public:
-		vertex_data(const vector<float> &p, const vector<float> &uv, const vector<float> &n) :
-			v_data(p), vt_data(uv), vn_data(n) {
-			v_count = p.size();
-			vt_count = uv.size();
-			vn_count = n.size();
-			setVertexData();
-
-			if (v_count < 3 || v_count > 4)
-				throw;
-
-			if (vt_count != 0 && vt_count != 2)
-				throw;
+		enum attribute_flags : unsigned char { HAS_W = 1, HAS_UV = 2, HAS_NORMAL = 4 };
 
-			if (vn_count != 3 && vn_count != 0)
-				throw;
-		}
-
-		~vertex_data() {};
-
-		const int getUVOffset() const { return v_data.size() * sizeof(float); }
-		const int getNOffset() const { return getUVOffset() + (vt_data.size() * sizeof(float)); }
-		const int getStride() const { return all_data.size() * sizeof(float); }
-		const int getVSize() const { return v_count; }
-		const int getVTSize() const { return vt_count; }
-		const int getVNSize() const { return vn_count; }
-		const vector<float> getVData() const { return v_data; }
-		const vector<float> getVTData() const { return vt_data; }
-		const vector<float> getVNData() const { return vn_data; }
+		vertex_data() : xyzw(0.0f, 0.0f, 0.0f, 1.0f), uv(0.0f, 0.0f), n_xyz(0.0f, 0.0f, 0.0f), attributes(0) {}
+		vertex_data(const vector<float> &p, const vector<float> &uv, const vector<float> &n) :
+			vertex_data(array_view<float>(p), array_view<float>(uv), array_view<float>(n)) {}
+		//throws std::invalid_argument unless p has 3 or 4 floats, uv 0, 2 or 3 (w is dropped) and n 0 or 3
+		vertex_data(array_view<float> p, array_view<float> uv, array_view<float> n);
+
+		const int getUVOffset() const { return getVSize() * sizeof(float); }
+		const int getNOffset() const { return getUVOffset() + (getVTSize() * sizeof(float)); }
+		const int getStride() const { return getNOffset() + (getVNSize() * sizeof(float)); }
+		const int getVSize() const { return (attributes & HAS_W) ? 4 : 3; }
+		const int getVTSize() const { return (attributes & HAS_UV) ? 2 : 0; }
+		const int getVNSize() const { return (attributes & HAS_NORMAL) ? 3 : 0; }
+		//most floats getVSize, getVTSize and getVNSize can add up to, raising it raises vertex_hash_index::MAX_PROBES with it
+		static const int MAX_COMPONENTS = 4 + 2 + 3;
+		//views into the vertex, valid until it is modified or destroyed
+		array_view<float> getVData() const { return array_view<float>(&xyzw.x, getVSize()); }
+		array_view<float> getVTData() const { return array_view<float>(&uv.x, getVTSize()); }
+		array_view<float> getVNData() const { return array_view<float>(&n_xyz.x, getVNSize()); }
 
 		//modifyPosition does not affect normals
 		void modifyPosition(const glm::mat4 &translation_matrix);
-		//rotate modifies position data and normals
+		//rotate modifies position data and normals, normals by the inverse transpose so translation and scaling don't bend them
 		void rotate(const glm::mat4 &rotation_matrix);
 
-		vector<float> getAllData() const { return all_data; }
+		//appends the position, uv and normal floats present, getStride() bytes in all
+		void appendAllData(vector<float> &data) const;
 
 		bool operator == (const vertex_data &other) const;
-		bool operator != (const vertex_data &other) { return !((*this) == other); }
+		bool operator != (const vertex_data &other) const { return !((*this) == other); }
 
-		float x, y, z, w;
-		glm::vec2 xy;
-		glm::vec3 xyz;
 		glm::vec4 xyzw;
-
-		float u, v;
 		glm::vec2 uv;
-
-		float n_x, n_y, n_z;
-		glm::vec2 n_xy;
 		glm::vec3 n_xyz;
+		unsigned char attributes;
+	};
+
+	//folds value into hash, the step every hash over mesh data is built from
+	unsigned long long mixHash(unsigned long long hash, unsigned long long value);
+
+	//open-addressing hash over the quantized attributes of stored vertices, so finding a vertex equal
+	//to another (by vertex_data::operator ==, tolerance included) costs amortized constant time
+	//only indices are stored, find is given the lookup that turns an index back into its vertex
+	class vertex_hash_index
+	{
+	public:
+		vertex_hash_index() : entry_count(0) {}
+
+		//lowest stored index whose vertex equals the one given, -1 if there is none
+		template <typename Lookup>
+		int find(const vertex_data &vertex, const Lookup &lookup) const;
+		void insert(const vertex_data &vertex, int index);
+		void clear() { entries.clear(); entry_count = 0; }
+
+		int size() const { return entry_count; }
+
+		//a vertex with n components near a cell edge is looked for in up to 2^n cells
+		static const int MAX_PROBES = 1 << vertex_data::MAX_COMPONENTS;
+
+		//hash of the cells holding vertex, what insert stores it under
+		static unsigned long long getCellHash(const vertex_data &vertex);
+		//getCellHash, followed by the hashes of neighbouring cells it may also match in
+		static int getProbeHashes(const vertex_data &vertex, unsigned long long* hashes);
 
 	private:
+		struct entry
+		{
+			unsigned long long hash;
+			//-1 marks an empty slot
+			int index;
+		};
 
-		void setVertexData();
-		vector<float> v_data;
-		vector<float> vt_data;
-		vector<float> vn_data;
-		vector<float> vp_data;
+		void grow();
 
-		vector<float> all_data;
+		vector<entry> entries;
+		int entry_count;
+	};
+
+	template <typename Lookup>
+	int vertex_hash_index::find(const vertex_data &vertex, const Lookup &lookup) const
+	{
+		if (entry_count == 0)
+			return -1;
 
-		unsigned short v_count, vt_count, vn_count, vp_count;
+		unsigned long long hashes[MAX_PROBES];
+		int hash_count = getProbeHashes(vertex, hashes);
+
+		std::size_t mask = entries.size() - 1;
+		int found = -1;
+
+		for (int i = 0; i < hash_count; i++)
+		{
+			for (std::size_t slot = hashes[i] & mask; entries[slot].index != -1; slot = (slot + 1) & mask)
+			{
+				const entry &candidate = entries[slot];
+
+				if (candidate.hash == hashes[i] && (found == -1 || candidate.index < found) && lookup(candidate.index) == vertex)
+					found = candidate.index;
+			}
+		}
+
+		return found;
+	}
+
+	//entries in the simulated post-transform vertex cache, typical of current gpus
+	const int VERTEX_CACHE_SIZE = 16;
+
+	//how a fifo post-transform vertex cache of a given size fares on an index buffer
+	//counts rather than ratios, so stats of several meshes can be summed
+	struct vertex_cache_stats
+	{
+		unsigned long long misses;
+		unsigned long long triangle_count;
+		unsigned long long vertex_count;
+
+		//average cache miss ratio, transformed vertices per triangle, 3 at worst and about 0.5 on a large regular grid
+		double getACMR() const { return triangle_count > 0 ? double(misses) / triangle_count : 0.0; }
+		//average transform to vertex ratio, 1 when every vertex is transformed exactly once
+		double getATVR() const { return vertex_count > 0 ? double(misses) / vertex_count : 0.0; }
+	};
+
+	vertex_cache_stats measureVertexCache(array_view<unsigned int> indices, std::size_t vertex_count, int cache_size = VERTEX_CACHE_SIZE);
+
+	//a simplified index list over the same vertex table as the mesh it was built from
+	//error is the rms distance (in model units, as built) of the collapsed surface from the original planes
+	struct mesh_lod
+	{
+		vector<unsigned int> element_index;
+		float error;
 	};
 
+	//the vertex table is allocated from the resource given, which must outlive the mesh
+	//a copy allocates from the default resource, a moved mesh keeps its resource
 	class mesh_data
 	{
 	public:
-		mesh_data() : total_face_count(0), vertex_count(0) {};
-		~mesh_data() {};
+		mesh_data() : mesh_data(std::pmr::get_default_resource()) {};
+		explicit mesh_data(std::pmr::memory_resource* resource) :
+			vertices(resource), vertex_tangents(resource), vertex_bitangents(resource),
+			interleave_stride(0), interleave_vt_offset(0), interleave_vn_offset(0),
+			v_size(0), vt_size(0), vn_size(0), vp_size(0), tan_size(3), bitan_size(3),
+			vertex_count(0), total_face_count(0), total_float_count(0) {};
 
 		void setMeshName(string n) { mesh_name = n; }
 		void setMaterialName(string n) { material_name = n; }
@@ -817,21 +1168,29 @@ namespace jep
 		const string getMeshlName() const { return mesh_name; }
 
 		//this data keeps list of vertex information as used by OpenGL
-		void addVData(const vector<float> &data) { all_v_data.insert(all_v_data.end(), data.begin(), data.end()); }
-		void addVTData(const vector<float> &data) { all_vt_data.insert(all_vt_data.end(), data.begin(), data.end()); }
-		void addVNData(const vector<float> &data) { all_vn_data.insert(all_vn_data.end(), data.begin(), data.end()); }
-		void addVPData(const vector<float> &data) { all_vp_data.insert(all_vp_data.end(), data.begin(), data.end()); }
-		void addFace(const vector<vertex_data> &data);
-		void addTangentBitangent(const vector<glm::vec3> &tb);
-		vector<glm::vec3> calcTangentBitangent(const vector<vertex_data> &face_data);
+		void addVData(array_view<float> data) { all_v_data.insert(all_v_data.end(), data.begin(), data.end()); }
+		void addVTData(array_view<float> data) { all_vt_data.insert(all_vt_data.end(), data.begin(), data.end()); }
+		void addVNData(array_view<float> data) { all_vn_data.insert(all_vn_data.end(), data.begin(), data.end()); }
+		void addVPData(array_view<float> data) { all_vp_data.insert(all_vp_data.end(), data.begin(), data.end()); }
+		void addFace(array_view<vertex_data> data);
+		//unnormalized tangent and bitangent of one triangle, from its positions and uvs
+		vector<glm::vec3> calcTangentBitangent(array_view<vertex_data> face_data);
+		//tangent frames for every vertex of the table, run once the mesh is assembled (the loaders do)
+		//face tangents are summed per vertex, made orthonormal to the normal, and w set to the handedness (+1 or -1)
+		//bitangents come out as cross(normal, tangent) * w, a thread_count of 0 uses every hardware thread
+		void generateTangents(int thread_count = 1);
+		array_view<glm::vec4> getVertexTangents() const { return vertex_tangents; }
+		array_view<glm::vec3> getVertexBitangents() const { return vertex_bitangents; }
 
 		const int getInterleaveStride() const { return interleave_stride; }
 		const int getInterleaveVTOffset() const { return interleave_vt_offset; }
 		const int getInterleaveVNOffset() const { return interleave_vn_offset; }
 		const vector<float> getInterleaveData() const;
-		const vector<float> getIndexedVertexData(vector<unsigned short> &indices) const;
+		const vector<float> getIndexedVertexData(vector<unsigned int> &indices) const;
 		const vector<float> getIndexedVertexData() const;
-		const vector<unsigned short> getElementIndex() const { return element_index; }
+		const vector<unsigned int>& getElementIndex() const { return element_index; }
+		//narrowest index type that addresses every vertex of the mesh
+		const GLenum getIndexType() const { return getIndexTypeFor(vertices.size()); }
 
 		//returns # of floats per vertex type
 		const int getVSize() const { return v_size; }
@@ -845,36 +1204,69 @@ namespace jep
 		const int getFaceCount() const { return total_face_count; }
 		const int getFloatCount() const { return total_float_count; }
 
-		const vector<float> getVData() const { return all_v_data; }
-		const vector<float> getVTData() const { return all_vt_data; }
-		const vector<float> getVNData() const { return all_vn_data; }
-		const vector<float> getVPData() const { return all_vp_data; }
+		//accessors return references into the mesh, valid until it is modified, moved or destroyed
+		const vector<float>& getVData() const { return all_v_data; }
+		const vector<float>& getVTData() const { return all_vt_data; }
+		const vector<float>& getVNData() const { return all_vn_data; }
+		const vector<float>& getVPData() const { return all_vp_data; }
 
+		//both transform the whole vertex table in one simd pass (structure of arrays, sse or avx when compiled in),
+		//then rebuild the per-corner data and meshlet bounds
 		//modifyPosition does not affect normals
 		void modifyPosition(const glm::mat4 &translation_matrix);
-		//rotate modifies position data and normals
+		//rotate modifies position data and normals, normals by the inverse transpose so translation and scaling don't bend them
 		void rotate(const glm::mat4 &rotation_matrix);
 
+		//optional, reorders the triangles of element_index for the post-transform vertex cache (tipsify),
+		//then renumbers the vertex table in the order triangles first use it so vertex fetches run forwards
+		//LOD levels are renumbered to match and reordered too, meshlets are discarded,
+		//the unindexed per-corner data (getVData etc.) keeps its order
+		//before and after receive the simulated cache behaviour when given
+		void optimizeVertexCache(int cache_size = VERTEX_CACHE_SIZE, vertex_cache_stats* before = nullptr, vertex_cache_stats* after = nullptr);
+
+		//quadric error metric edge collapse down to about target_index_count indices, seams and open borders are kept
+		//collapses only move vertices onto existing ones, so the result indexes the same vertex table
+		vector<unsigned int> simplify(std::size_t target_index_count, float* error = nullptr) const;
+		//each level keeps about reduction of the previous one's triangles, the chain ends early once a level barely shrinks
+		void buildLODChain(int max_levels = 4, float reduction = 0.5f);
+		const vector<mesh_lod>& getLODs() const { return lods; }
+
+		//reorders element_index into meshlets of at most max_vertices vertices and max_triangles triangles,
+		//grown greedily across shared vertices, transforms keep their bounds up to date
+		//call after optimizeVertexCache, which discards them
+		void buildMeshlets(int max_vertices = MESHLET_MAX_VERTICES, int max_triangles = MESHLET_MAX_TRIANGLES);
+		const vector<meshlet>& getMeshlets() const { return meshlets; }
+
+		//edges on an open border, as positions, found through a half_edge_mesh
 		vector< std::pair<glm::vec4, glm::vec4> > getMeshEdgesVec4() const;
 		vector< std::pair<glm::vec3, glm::vec3> > getMeshEdgesVec3() const;
 		vector< vector<glm::vec4> >getMeshTrianglesVec4() const;
 		vector< vector<glm::vec3> >getMeshTrianglesVec3() const;
 
-		map<unsigned short, vertex_data> getVertexMap() const { return vertex_map; }
+		//unique vertices, element_index refers to them by position
+		array_view<vertex_data> getVertices() const { return vertices; }
 
 		void setMeshData();
 
 	private:
-		//vector of faces, each face is a vector of vertices
-		vector< vector<vertex_data> > faces;
-		map<unsigned short, vertex_data > vertex_map;
-		map<unsigned short, glm::vec3> tangent_map;
-		map<unsigned short, glm::vec3> bitangent_map;
+		friend class mesh_cache;
 
-		vector<unsigned short> element_index;
+		void rebuildVertexIndex();
+		void updateMeshletBounds();
 
-		vector<glm::vec3> tangents;
-		vector<glm::vec3> bitangents;
+		//each face is element_index entries naming its corners in the vertex table, 3 per face
+		std::pmr::vector<vertex_data> vertices;
+		//tangent frame of each vertex, empty until generateTangents
+		std::pmr::vector<glm::vec4> vertex_tangents;
+		std::pmr::vector<glm::vec3> vertex_bitangents;
+		//rebuilt from vertices whenever it is out of date, e.g. after loading from a cache or transforming
+		vertex_hash_index vertex_index;
+
+		vector<unsigned int> element_index;
+		//coarser levels of detail, empty unless buildLODChain was called
+		vector<mesh_lod> lods;
+		//partition of element_index, empty unless buildMeshlets was called
+		vector<meshlet> meshlets;
 
 		string mesh_name;
 		string material_name;
@@ -905,24 +1297,289 @@ namespace jep
 		int total_float_count;
 	};
 
+	//marks a half-edge with no twin, i.e. one on an open border
+	const unsigned int NO_HALF_EDGE = 0xFFFFFFFF;
+
+	//half-edge adjacency of a mesh_data, built once in time linear in its faces
+	//half-edge h runs along face h / 3 from its corner h % 3 to the next one, so faces and next edges need no storage
+	//vertices sharing a position are welded to the lowest of them, so uv and normal seams aren't taken for borders
+	class half_edge_mesh
+	{
+	public:
+		half_edge_mesh(const mesh_data &mesh);
+		~half_edge_mesh() {};
+
+		std::size_t getHalfEdgeCount() const { return origins.size(); }
+		std::size_t getFaceCount() const { return origins.size() / 3; }
+
+		static unsigned int getFace(unsigned int half_edge) { return half_edge / 3; }
+		static unsigned int getNext(unsigned int half_edge) { return half_edge % 3 == 2 ? half_edge - 2 : half_edge + 1; }
+		static unsigned int getPrevious(unsigned int half_edge) { return half_edge % 3 == 0 ? half_edge + 2 : half_edge - 1; }
+
+		//welded vertices, indices into the mesh's vertex table
+		unsigned int getOrigin(unsigned int half_edge) const { return origins[half_edge]; }
+		unsigned int getDestination(unsigned int half_edge) const { return origins[getNext(half_edge)]; }
+		//the half-edge along the same edge in the neighbouring face, NO_HALF_EDGE on a border
+		//an edge shared by more than two faces pairs them off in face order, leaving any odd one as a border
+		unsigned int getTwin(unsigned int half_edge) const { return twins[half_edge]; }
+		unsigned int getWeldedVertex(unsigned int vertex) const { return welded[vertex]; }
+
+		//half-edges without a twin, in face order, degenerate edges excluded
+		vector<unsigned int> getBoundaryEdges() const;
+		//faces sharing an edge with face
+		vector<unsigned int> getNeighborFaces(unsigned int face) const;
+		//welded vertices sharing an edge with vertex, each once
+		vector<unsigned int> getVertexRing(unsigned int vertex) const;
+
+	private:
+		vector<unsigned int> welded;
+		vector<unsigned int> origins;
+		vector<unsigned int> twins;
+
+		//half-edges leaving each welded vertex, outgoing[outgoing_offset[v], outgoing_offset[v + 1])
+		vector<unsigned int> outgoing_offset;
+		vector<unsigned int> outgoing;
+	};
+
+	//a vertex in the packed formats, 24 bytes against the 56 of VERTEX_FLOAT
+	//position: x, y, z as half floats or snorm16 in [-1, 1] across the mesh bounds, then padding to keep 4 byte alignment
+	//uv: unorm16, or half floats when the uvs leave [0, 1]
+	//normal: octahedral encoded, snorm16
+	//tangent: octahedral encoded, snorm16, then its handedness as -1 or 1 and padding
+	struct packed_vertex
+	{
+		unsigned short position[4];
+		unsigned short uv[2];
+		unsigned short normal[2];
+		unsigned short tangent[4];
+	};
+
+	//glsl for a vertex shader reading the packed formats, attributes 0-3 as ogl_data sets them up, nothing at 4
+	//the snorm and unorm attributes arrive already normalized to floats, position_transform is part of the model matrix draw uploads
+	const char PACKED_VERTEX_GLSL[] = R"(
+		layout(location = 0) in vec3 packed_position;
+		layout(location = 1) in vec2 packed_uv;
+		layout(location = 2) in vec2 packed_normal;
+		layout(location = 3) in vec3 packed_tangent;
+
+		//inverse of encodeOctahedral, the lower half of the octahedron is folded back from the corners of the square
+		vec3 decodeOctahedral(vec2 encoded)
+		{
+			vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+			float fold = max(-direction.z, 0.0);
+			direction.x += direction.x >= 0.0 ? -fold : fold;
+			direction.y += direction.y >= 0.0 ? -fold : fold;
+			return normalize(direction);
+		}
+
+		//the bitangent isn't uploaded, it is rebuilt from the normal, the tangent and the tangent's handedness
+		void decodePackedFrame(out vec3 normal, out vec3 tangent, out vec3 bitangent)
+		{
+			normal = decodeOctahedral(packed_normal);
+			tangent = decodeOctahedral(packed_tangent.xy);
+			bitangent = cross(normal, tangent) * (packed_tangent.z < 0.0 ? -1.0 : 1.0);
+		}
+	)";
+
+	struct packed_vertex_data
+	{
+		vector<packed_vertex> vertices;
+		//model space position = position_transform * packed position, a uniform scale so normals need no correction
+		glm::mat4 position_transform;
+		//GL_HALF_FLOAT or GL_SHORT
+		GLenum position_type;
+		//GL_UNSIGNED_SHORT or GL_HALF_FLOAT
+		GLenum uv_type;
+	};
+
+	//quantizes the mesh's vertex table in order, so its element_index still applies
+	packed_vertex_data packVertices(const mesh_data &mesh, vertex_format format);
+	//ieee 754 binary16, rounded to nearest even
+	unsigned short floatToHalf(float value);
+	//unit vector to a point in [-1, 1]^2, and back
+	glm::vec2 encodeOctahedral(const glm::vec3 &direction);
+	glm::vec3 decodeOctahedral(const glm::vec2 &encoded);
+
+	//read-only memory mapping of an entire file, the mapping is released when the object is destroyed
+	class file_mapping
+	{
+	public:
+		file_mapping(const char* file_path);
+		~file_mapping();
+
+		file_mapping(const file_mapping &) = delete;
+		file_mapping& operator = (const file_mapping &) = delete;
+
+		bool isOpen() const { return open; }
+		const char* data() const { return mapped_data; }
+		std::size_t size() const { return mapped_size; }
+		array_view<char> getView() const { return array_view<char>(mapped_data, mapped_size); }
+
+		//hints that a range already read won't be needed again, so its pages can leave memory
+		void release(std::size_t offset, std::size_t length) const;
+
+	private:
+		const char* mapped_data;
+		std::size_t mapped_size;
+		bool open;
+
+	#ifdef _WIN32
+		void* file_handle;
+		void* mapping_handle;
+	#else
+		int file_descriptor;
+	#endif
+	};
+
+	//raw obj elements of one type (v, vt, vn or vp) stored back to back, stride floats apart
+	//an element may specify fewer floats than the stride, so the count given for each one is kept too
+	class raw_element_array
+	{
+	public:
+		raw_element_array(int element_stride) : stride(element_stride) {}
+		~raw_element_array() {};
+
+		//appends an element, floats past the stride are dropped
+		void add(const float* floats, int count);
+		//sets an element of a presized array, used by parser threads filling disjoint ranges
+		void set(int n, const float* floats, int count);
+		void resize(int element_count);
+		void reserve(int element_count);
+
+		//obj indices begin at 1, throws std::out_of_range for undefined elements
+		array_view<float> at(int n) const;
+
+		int size() const { return int(element_sizes.size()); }
+		int getStride() const { return stride; }
+		int getElementSize(int n) const { return element_sizes.at(n - 1); }
+
+		//every element, stride floats apart, unused trailing floats are 0
+		array_view<float> getValues() const { return array_view<float>(values); }
+
+	private:
+		vector<float> values;
+		vector<unsigned char> element_sizes;
+		int stride;
+	};
+
+	//identifies the exact obj file a mesh cache was generated from
+	struct mesh_cache_key
+	{
+		string source_path;
+		unsigned long long file_size;
+		long long modified_time;
+		unsigned long long content_hash;
+	};
+
+	//versioned binary snapshot of the meshes generated from an obj file, read back through a memory mapping
+	//a cache whose key, version or checksum doesn't match is treated as missing
+	class mesh_cache
+	{
+	public:
+		static string getCachePath(const char* obj_file);
+
+		//fills size and modification time, the content hash is only computed when hash_contents is set
+		static bool getSourceKey(const char* obj_file, mesh_cache_key &key, bool hash_contents);
+
+		static bool load(const char* cache_file, const char* obj_file, vector<mesh_data> &meshes);
+		static bool save(const char* cache_file, const mesh_cache_key &key, const vector<mesh_data> &meshes);
+
+	private:
+		static void writeMesh(string &buffer, const mesh_data &mesh);
+		static bool readMesh(const char* &cursor, const char* end, mesh_data &mesh);
+	};
+
+	//decompresses a .gz or .zst file on a background thread, handing the text out a block at a time
+	//a few blocks are decoded ahead, so decompression overlaps with whatever consumes them
+	class compressed_reader
+	{
+	public:
+		//judged by extension, ".gz" or ".zst"
+		static compression_type getCompression(const char* file_path);
+
+		compressed_reader(const char* file_path, std::size_t block_size = 4 << 20, int blocks_ahead = 3);
+		//stops decompressing and waits for the background thread
+		~compressed_reader();
+
+		compressed_reader(const compressed_reader &) = delete;
+		compressed_reader& operator = (const compressed_reader &) = delete;
+
+		bool isOpen() const { return open; }
+
+		//waits for the next block of decompressed text, false once every block has been handed out
+		//or straight away when the file couldn't be opened
+		bool nextBlock(string &block);
+
+		//set when the file couldn't be opened, or its compressed data turned out to be corrupt or truncated
+		const string getError() const;
+
+		std::size_t getCompressedSize() const { return compressed_size; }
+		//how much of the compressed file has been decoded so far
+		std::size_t getCompressedBytesRead() const { return compressed_read; }
+
+	private:
+		void decompress();
+
+		string file_path;
+		compression_type compression;
+		std::size_t block_size;
+		std::size_t blocks_ahead;
+		std::size_t compressed_size;
+		std::atomic<std::size_t> compressed_read;
+		bool open;
+
+		mutable std::mutex reader_mutex;
+		std::condition_variable block_added;
+		std::condition_variable block_taken;
+		std::deque<string> blocks;
+		bool finished;
+		bool stopping;
+		string error;
+
+		std::thread decompressor;
+	};
+
 	class obj_contents
 	{
 	public:
-		obj_contents(const char* obj_file);
+		//maps the file into memory and parses it in place
+		//.gz and .zst files are decompressed in blocks on a background thread and always parsed as a stream
+		//thread_count > 1 tokenizes line-aligned chunks and assembles meshes in parallel, 0 uses every core
+		//the result is identical to a single-threaded parse
+		//when timings is given, the time spent in each stage is written to it
+		//meshes are allocated from resource (the default resource when null), which must outlive them,
+		//load-time scratch lives in arenas drawing on it that are released in one go as each stage ends,
+		//parse threads share it, so with thread_count != 1 it must be thread-safe
+		obj_contents(const char* obj_file, int thread_count = 1, obj_parse_timings* timings = nullptr, std::pmr::memory_resource* resource = nullptr);
+		//parses obj text already held in memory, the buffer only needs to outlive the constructor
+		obj_contents(array_view<char> obj_data, int thread_count = 1, obj_parse_timings* timings = nullptr, std::pmr::memory_resource* resource = nullptr);
+		//streaming parse, each mesh goes to on_mesh when its group closes instead of being stored
+		//only the raw elements (which any later face may reference) and the open mesh stay in memory
+		//on_progress is called as the parse starts, after every megabyte read and once the input is consumed
+		obj_contents(const char* obj_file, const mesh_callback &on_mesh, const progress_callback &on_progress = progress_callback(),
+			std::pmr::memory_resource* resource = nullptr);
+		obj_contents(array_view<char> obj_data, const mesh_callback &on_mesh, const progress_callback &on_progress = progress_callback(),
+			std::pmr::memory_resource* resource = nullptr);
+		//lazy parse, raw elements are read and every mesh is indexed by getGroups, but no mesh is built until loadGroups asks for it
+		//the file (or a compressed file's text) stays in memory while any copy of this object exists, an in-memory buffer must outlive it
+		obj_contents(const char* obj_file, obj_load_mode mode, std::pmr::memory_resource* resource = nullptr);
+		obj_contents(array_view<char> obj_data, obj_load_mode mode, std::pmr::memory_resource* resource = nullptr);
 		~obj_contents() {};
 
-		const map<int, vector<float> > getAllRawVData() const { return raw_v_data; }
-		const map<int, vector<float> > getAllRawVTData() const { return raw_vt_data; }
-		const map<int, vector<float> > getAllRawVNData() const { return raw_vn_data; }
-		const map<int, vector<float> > getAllRawVPData() const { return raw_vp_data; }
+		const raw_element_array& getAllRawVData() const { return raw_v_data; }
+		const raw_element_array& getAllRawVTData() const { return raw_vt_data; }
+		const raw_element_array& getAllRawVNData() const { return raw_vn_data; }
+		const raw_element_array& getAllRawVPData() const { return raw_vp_data; }
 
-		const vector<float> getRawVData(int n) const { return raw_v_data.at(n); }
-		const vector<float> getRawVTData(int n) const { return raw_vt_data.at(n); }
-		const vector<float> getRawVNData(int n) const { return raw_vn_data.at(n); }
-		const vector<float> getRawVPData(int n) const { return raw_vp_data.at(n); }
+		array_view<float> getRawVData(int n) const { return raw_v_data.at(n); }
+		array_view<float> getRawVTData(int n) const { return raw_vt_data.at(n); }
+		array_view<float> getRawVNData(int n) const { return raw_vn_data.at(n); }
+		array_view<float> getRawVPData(int n) const { return raw_vp_data.at(n); }
 
 		const int getMeshCount() const { return meshes.size(); }
-		const vector<mesh_data> getMeshes() const { return meshes; }
+		const vector<mesh_data>& getMeshes() const { return meshes; }
+		//moves the meshes out without copying their geometry, getMeshes is empty afterwards
+		vector<mesh_data> takeMeshes();
 
 		vector<string> getErrors() const { return error_log; }
 
@@ -930,24 +1587,211 @@ namespace jep
 
 		const string getMTLFilename() const { return mtl_filename; }
 
+		//meshes found by a lazy parse, in file order, empty otherwise
+		const vector<obj_group>& getGroups() const { return groups; }
+		//builds the nth indexed mesh
+		mesh_data loadGroup(int n) const;
+		//builds every indexed mesh with one of the names given, in file order
+		vector<mesh_data> loadGroups(const vector<string> &names, int thread_count = 1) const;
+
 	private:
-		void addRawData(const vector<float> &floats, DATA_TYPE dt);
+		void parseContents(const char* begin, const char* end, int thread_count, obj_parse_timings* timings);
+		void mergeChunks(const vector<obj_parse_chunk> &chunks, vector< vector< array_view<face_index> > > &mesh_faces);
+		bool applyRecord(const obj_parse_chunk &chunk, const parse_record &record, mesh_data &mesh,
+			bool &end_of_vertex_data, string &current_material);
+		//resolution_seconds and assembly_seconds accumulate per stage time when given
+		//scratch_allocations counts what the per-face scratch arenas served when given
+		void buildMesh(mesh_data &mesh, const vector< array_view<face_index> > &faces, double* resolution_seconds = nullptr,
+			double* assembly_seconds = nullptr, unsigned long long* scratch_allocations = nullptr) const;
+		void buildFace(mesh_data &mesh, array_view<face_index> corners, double* resolution_seconds = nullptr,
+			double* assembly_seconds = nullptr, unsigned long long* scratch_allocations = nullptr) const;
+		void streamContents(const char* begin, const char* end, const file_mapping* file,
+			const mesh_callback &on_mesh, const progress_callback &on_progress);
+		bool streamCompressed(const char* obj_file, const mesh_callback &on_mesh, const progress_callback &on_progress);
+		void beginStream(obj_stream_state &state);
+		void streamLine(obj_stream_state &state, string_view line, const mesh_callback &on_mesh);
+		void endStream(obj_stream_state &state, const mesh_callback &on_mesh);
+		void indexContents(const char* begin, const char* end);
 
-		//uses vector<float> because # of floats per vertex varies
 		//data direct from obj file, unformatted
-		map<int, vector<float> > raw_v_data;
-		map<int, vector<float> > raw_vt_data;
-		map<int, vector<float> > raw_vn_data;
-		map<int, vector<float> > raw_vp_data;
+		raw_element_array raw_v_data;
+		raw_element_array raw_vt_data;
+		raw_element_array raw_vn_data;
+		raw_element_array raw_vp_data;
 		string mtl_filename;
 
-		int v_index_counter;
-		int vt_index_counter;
-		int vn_index_counter;
-		int vp_index_counter;
-
 		vector<string> error_log;
 		vector<mesh_data> meshes;
+		std::pmr::memory_resource* mesh_resource;
+
+		//source of a lazy parse, kept so indexed meshes can be built later
+		boost::shared_ptr<file_mapping> source_file;
+		boost::shared_ptr<string> source_text;
+		const char* source_data;
+		vector<obj_group> groups;
+	};
+
+	//seconds spent in each stage of an obj_contents parse
+	struct obj_parse_timings
+	{
+		double count_seconds;
+		double tokenize_seconds;
+		double merge_seconds;
+		//wall time of the stage that turns faces into meshes
+		double build_seconds;
+		//summed across threads, resolution creates vertex_data from face indices,
+		//assembly is mesh_data::addFace (vertex dedup)
+		double face_resolution_seconds;
+		double mesh_assembly_seconds;
+		//wall time of mesh_data::generateTangents over every mesh, after the build stage
+		double tangent_seconds;
+		//allocations served by the per-face scratch arenas, each would otherwise have gone to the heap
+		unsigned long long scratch_allocations;
+	};
+
+	//what a lazily loaded obj_contents knows about one mesh before it is built
+	struct obj_group
+	{
+		string name;
+		string material;
+
+		//the mesh's lines occupy [begin_offset, end_offset) of the source
+		std::size_t begin_offset;
+		std::size_t end_offset;
+
+		//# of v, vt, vn and vp elements defined before begin_offset, relative face indices resolve against these
+		int raw_base[4];
+
+		int face_count;
+		//lowest and highest position index referenced by the mesh's faces, both 0 when it has none
+		int first_v;
+		int last_v;
+	};
+
+	//a material as read from an mtl file, before any of its textures exist
+	struct material_description
+	{
+		string name;
+		map<DATA_TYPE, vector<float> > data;
+		string diffuse_filename;
+		string bump_filename;
+		float bump_value;
+		bool bump_value_set;
+	};
+
+	//everything loadModelBatch produced for one obj file
+	struct loaded_model
+	{
+		string obj_file;
+		//the obj's mtllib, resolved against the obj's directory, empty when it names none
+		string mtl_file;
+		vector<mesh_data> meshes;
+		//the same material objects are shared by every model naming the same mtl file
+		map<string, boost::shared_ptr<material_data> > materials;
+		vector<string> errors;
+	};
+
+	//fixed set of worker threads, each with its own task deque
+	//a worker runs its newest task first and steals the oldest task of another worker once its own run out,
+	//tasks may submit further tasks, which land on the submitting worker's deque
+	class task_pool
+	{
+	public:
+		//0 uses every core
+		task_pool(int thread_count = 0);
+		//waits for every task, then stops the workers
+		~task_pool();
+
+		task_pool(const task_pool &) = delete;
+		task_pool& operator = (const task_pool &) = delete;
+
+		void submit(const std::function<void()> &task);
+		//blocks until every task submitted so far, and every task they submit, has run
+		//rethrows the first exception a task threw
+		void wait();
+
+		int getThreadCount() const { return int(workers.size()); }
+
+	private:
+		struct worker_queue
+		{
+			std::mutex queue_mutex;
+			std::deque< std::function<void()> > tasks;
+		};
+
+		void work(int index);
+		bool takeTask(int index, std::function<void()> &task);
+
+		vector< boost::shared_ptr<worker_queue> > queues;
+		vector<std::thread> workers;
+
+		std::mutex pool_mutex;
+		std::condition_variable task_added;
+		std::condition_variable tasks_done;
+		int queued_count;
+		int unfinished_count;
+		bool stopping;
+		std::exception_ptr first_exception;
+		std::atomic<unsigned int> next_queue;
+	};
+
+	struct load_progress
+	{
+		std::size_t bytes_parsed;
+		std::size_t bytes_total;
+		int meshes_built;
+		int faces_built;
+		bool finished;
+	};
+
+	//parses an obj file on a background thread, handing over each mesh as soon as its group is built
+	//GL objects can only be created on the context's thread, so the render loop collects finished meshes
+	//with takeFinishedMeshes and creates their ogl_data itself, materials are still loaded there with generateMaterials
+	class mesh_loader
+	{
+	public:
+		//loading starts immediately
+		mesh_loader(const char* obj_file);
+		//stops a load still in progress and waits for the background thread
+		~mesh_loader();
+
+		mesh_loader(const mesh_loader &) = delete;
+		mesh_loader& operator = (const mesh_loader &) = delete;
+
+		load_progress getProgress() const;
+		bool isFinished() const { return finished; }
+
+		//moves out every mesh finished since the last call, never blocks on the parse
+		vector<mesh_data> takeFinishedMeshes();
+
+		//becomes ready once loading ends, false if the file couldn't be opened or the load was stopped
+		std::shared_future<bool> getFuture() const { return done; }
+
+		//only meaningful once loading has finished
+		const string getMTLFilename() const;
+		vector<string> getErrors() const;
+
+	private:
+		void load();
+		void addMesh(mesh_data &mesh);
+
+		string obj_file;
+
+		mutable std::mutex loader_mutex;
+		vector<mesh_data> finished_meshes;
+		string mtl_filename;
+		vector<string> error_log;
+
+		std::atomic<std::size_t> bytes_parsed;
+		std::atomic<std::size_t> bytes_total;
+		std::atomic<int> meshes_built;
+		std::atomic<int> faces_built;
+		std::atomic<bool> finished;
+		std::atomic<bool> cancelled;
+
+		std::promise<bool> result;
+		std::shared_future<bool> done;
+		std::thread worker;
 	};
 
 	class material_data
@@ -0,0 +1,153 @@
+#include "ogl_tools.h"
+#include <algorithm>
+
+namespace jep
+{
+	//lets submit find the calling worker's own deque
+	thread_local const task_pool* current_pool = nullptr;
+	thread_local int current_worker = -1;
+
+	task_pool::task_pool(int thread_count) :
+		queued_count(0), unfinished_count(0), stopping(false), next_queue(0)
+	{
+		if (thread_count < 1)
+			thread_count = std::max(1, int(std::thread::hardware_concurrency()));
+
+		for (int i = 0; i < thread_count; i++)
+			queues.push_back(boost::shared_ptr<worker_queue>(new worker_queue));
+
+		for (int i = 0; i < thread_count; i++)
+			workers.push_back(std::thread(&task_pool::work, this, i));
+	}
+
+	task_pool::~task_pool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(pool_mutex);
+			tasks_done.wait(lock, [this]() { return unfinished_count == 0; });
+			stopping = true;
+		}
+
+		task_added.notify_all();
+
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+
+	void task_pool::submit(const std::function<void()> &task)
+	{
+		//tasks from a worker stay local, others are spread round robin
+		int index = (current_pool == this) ? current_worker : int(next_queue++ % queues.size());
+
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			unfinished_count++;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(queues[index]->queue_mutex);
+			queues[index]->tasks.push_back(task);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			queued_count++;
+		}
+
+		task_added.notify_one();
+	}
+
+	void task_pool::wait()
+	{
+		std::unique_lock<std::mutex> lock(pool_mutex);
+		tasks_done.wait(lock, [this]() { return unfinished_count == 0; });
+
+		if (first_exception)
+		{
+			std::exception_ptr thrown = first_exception;
+			first_exception = nullptr;
+			std::rethrow_exception(thrown);
+		}
+	}
+
+	bool task_pool::takeTask(int index, std::function<void()> &task)
+	{
+		//own deque from the back, most recently submitted and most likely still in cache
+		{
+			worker_queue &own = *queues[index];
+			std::lock_guard<std::mutex> lock(own.queue_mutex);
+
+			if (!own.tasks.empty())
+			{
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+
+		//other deques from the front, the oldest work is usually the largest left
+		for (std::size_t offset = 1; offset < queues.size(); offset++)
+		{
+			worker_queue &victim = *queues[(index + offset) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.queue_mutex);
+
+			if (!victim.tasks.empty())
+			{
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void task_pool::work(int index)
+	{
+		current_pool = this;
+		current_worker = index;
+
+		while (true)
+		{
+			std::function<void()> task;
+
+			if (!takeTask(index, task))
+			{
+				std::unique_lock<std::mutex> lock(pool_mutex);
+				task_added.wait(lock, [this]() { return queued_count > 0 || stopping; });
+
+				if (stopping && queued_count == 0)
+					return;
+
+				continue;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(pool_mutex);
+				queued_count--;
+			}
+
+			try
+			{
+				task();
+			}
+
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(pool_mutex);
+
+				if (!first_exception)
+					first_exception = std::current_exception();
+			}
+
+			bool all_done;
+			{
+				std::lock_guard<std::mutex> lock(pool_mutex);
+				all_done = (--unfinished_count == 0);
+			}
+
+			if (all_done)
+				tasks_done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,210 @@
+#include "ogl_tools.h"
+
+namespace jep
+{
+	vertex_cache_stats measureVertexCache(array_view<unsigned int> indices, std::size_t vertex_count, int cache_size)
+	{
+		vertex_cache_stats stats;
+		stats.misses = 0;
+		stats.triangle_count = indices.size() / 3;
+		stats.vertex_count = vertex_count;
+
+		//a vertex is cached while fewer than cache_size misses have happened since its own
+		vector<unsigned long long> miss_time(vertex_count, 0);
+		unsigned long long time = (unsigned long long)cache_size + 1;
+
+		for (unsigned int index : indices)
+		{
+			if (index >= vertex_count)
+				continue;
+
+			if (time - miss_time[index] > (unsigned long long)cache_size)
+			{
+				miss_time[index] = time++;
+				stats.misses++;
+			}
+		}
+
+		return stats;
+	}
+
+	//tipsify (Sander, Nehab and Barczak 2007)
+	//fans around one vertex at a time, moving on to the candidate that will still be cached once its remaining
+	//triangles are emitted, or back to an earlier vertex with triangles left when there is none
+	void tipsify(const vector<unsigned int> &indices, std::size_t vertex_count, int cache_size, vector<unsigned int> &triangle_order)
+	{
+		std::size_t triangle_count = indices.size() / 3;
+
+		//triangles using each vertex, as offsets into one array
+		vector<unsigned int> live_count(vertex_count, 0);
+		for (unsigned int index : indices)
+			live_count[index]++;
+
+		vector<std::size_t> adjacency_offset(vertex_count + 1, 0);
+		for (std::size_t v = 0; v < vertex_count; v++)
+			adjacency_offset[v + 1] = adjacency_offset[v] + live_count[v];
+
+		vector<unsigned int> adjacency(indices.size());
+		vector<std::size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (std::size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+		vector<unsigned long long> cache_time(vertex_count, 0);
+		vector<char> emitted(triangle_count, 0);
+		vector<unsigned int> dead_end;
+		vector<unsigned int> candidates;
+
+		unsigned long long time = (unsigned long long)cache_size + 1;
+		std::size_t cursor = 0;
+
+		triangle_order.clear();
+		triangle_order.reserve(triangle_count);
+
+		long long fanning = vertex_count > 0 ? 0 : -1;
+
+		while (fanning >= 0)
+		{
+			candidates.clear();
+
+			for (std::size_t a = adjacency_offset[fanning]; a < adjacency_offset[fanning + 1]; a++)
+			{
+				unsigned int triangle = adjacency[a];
+				if (emitted[triangle])
+					continue;
+
+				emitted[triangle] = 1;
+				triangle_order.push_back(triangle);
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					unsigned int v = indices[triangle * 3 + corner];
+					dead_end.push_back(v);
+					candidates.push_back(v);
+					live_count[v]--;
+
+					if (time - cache_time[v] > (unsigned long long)cache_size)
+						cache_time[v] = time++;
+				}
+			}
+
+			//the candidate that has been in the cache longest but will still be in it once its fan is done
+			fanning = -1;
+			long long best_priority = -1;
+
+			for (unsigned int v : candidates)
+			{
+				if (live_count[v] == 0)
+					continue;
+
+				long long priority = 0;
+				if (time - cache_time[v] + 2 * live_count[v] <= (unsigned long long)cache_size)
+					priority = (long long)(time - cache_time[v]);
+
+				if (priority > best_priority)
+				{
+					best_priority = priority;
+					fanning = v;
+				}
+			}
+
+			if (fanning != -1)
+				continue;
+
+			//dead end, back up to a recently touched vertex, then to the next vertex in order, with triangles left
+			while (!dead_end.empty() && fanning == -1)
+			{
+				unsigned int v = dead_end.back();
+				dead_end.pop_back();
+
+				if (live_count[v] > 0)
+					fanning = v;
+			}
+
+			for (; cursor < vertex_count && fanning == -1; cursor++)
+			{
+				if (live_count[cursor] > 0)
+					fanning = cursor;
+			}
+		}
+	}
+
+	void mesh_data::optimizeVertexCache(int cache_size, vertex_cache_stats* before, vertex_cache_stats* after)
+	{
+		if (before != nullptr)
+			*before = measureVertexCache(element_index, vertices.size(), cache_size);
+
+		vector<unsigned int> triangle_order;
+		tipsify(element_index, vertices.size(), cache_size, triangle_order);
+
+		//vertices are renumbered in the order the reordered triangles first use them, so fetches walk the buffer forwards
+		const unsigned int unassigned = 0xFFFFFFFF;
+		vector<unsigned int> remap(vertices.size(), unassigned);
+		vector<unsigned int> reordered_index;
+		reordered_index.reserve(element_index.size());
+		unsigned int next_vertex = 0;
+
+		for (unsigned int triangle : triangle_order)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int v = element_index[triangle * 3 + corner];
+
+				if (remap[v] == unassigned)
+					remap[v] = next_vertex++;
+
+				reordered_index.push_back(remap[v]);
+			}
+		}
+
+		//vertices no face uses keep their place after the rest
+		for (unsigned int &new_position : remap)
+		{
+			if (new_position == unassigned)
+				new_position = next_vertex++;
+		}
+
+		std::pmr::vector<vertex_data> reordered_vertices(vertices.size(), vertices.get_allocator());
+		std::pmr::vector<glm::vec4> reordered_tangents(vertex_tangents.size(), vertex_tangents.get_allocator());
+		std::pmr::vector<glm::vec3> reordered_bitangents(vertex_bitangents.size(), vertex_bitangents.get_allocator());
+
+		for (std::size_t v = 0; v < vertices.size(); v++)
+			reordered_vertices[remap[v]] = vertices[v];
+
+		//tangent frames may not have been generated
+		for (std::size_t v = 0; v < vertex_tangents.size(); v++)
+		{
+			reordered_tangents[remap[v]] = vertex_tangents[v];
+			reordered_bitangents[remap[v]] = vertex_bitangents[v];
+		}
+
+		vertices.swap(reordered_vertices);
+		vertex_tangents.swap(reordered_tangents);
+		vertex_bitangents.swap(reordered_bitangents);
+		element_index.swap(reordered_index);
+
+		//coarser levels share the vertex table, they get the new numbering and a triangle order of their own
+		for (mesh_lod &lod : lods)
+		{
+			for (unsigned int &index : lod.element_index)
+				index = remap[index];
+
+			tipsify(lod.element_index, vertices.size(), cache_size, triangle_order);
+
+			vector<unsigned int> reordered_lod;
+			reordered_lod.reserve(lod.element_index.size());
+
+			for (unsigned int triangle : triangle_order)
+				reordered_lod.insert(reordered_lod.end(), &lod.element_index[triangle * 3], &lod.element_index[triangle * 3] + 3);
+
+			lod.element_index.swap(reordered_lod);
+		}
+
+		//positions in the table changed, it is rebuilt before the next face is added
+		vertex_index.clear();
+		meshlets.clear();
+		setMeshData();
+
+		if (after != nullptr)
+			*after = measureVertexCache(element_index, vertices.size(), cache_size);
+	}
+}
@@ -0,0 +1,174 @@
+#include "ogl_tools.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace jep
+{
+	unsigned short floatToHalf(float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		unsigned int sign = (bits >> 16) & 0x8000;
+		int exponent = int((bits >> 23) & 0xFF);
+		unsigned int mantissa = bits & 0x7FFFFF;
+
+		//infinity stays infinity, nan stays nan
+		if (exponent == 0xFF)
+			return (unsigned short)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+		int half_exponent = exponent - 127 + 15;
+
+		if (half_exponent >= 0x1F)
+			return (unsigned short)(sign | 0x7C00);
+
+		//too small for a normal half, shifted into a denormal or lost entirely
+		if (half_exponent <= 0)
+		{
+			if (half_exponent < -10)
+				return (unsigned short)sign;
+
+			mantissa |= 0x800000;
+			int shift = 14 - half_exponent;
+			unsigned int half_mantissa = mantissa >> shift;
+			unsigned int remainder = mantissa & ((1u << shift) - 1);
+			unsigned int halfway = 1u << (shift - 1);
+
+			if (remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+				half_mantissa++;
+
+			return (unsigned short)(sign | half_mantissa);
+		}
+
+		//rounds to nearest even, a carry out of the mantissa correctly bumps the exponent
+		unsigned int half = sign | (unsigned int)(half_exponent << 10) | (mantissa >> 13);
+		unsigned int remainder = mantissa & 0x1FFF;
+
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+			half++;
+
+		return (unsigned short)half;
+	}
+
+	unsigned short floatToSnorm16(float value)
+	{
+		float clamped = std::max(-1.0f, std::min(1.0f, value));
+		return (unsigned short)(short)std::lround(clamped * 32767.0f);
+	}
+
+	unsigned short floatToUnorm16(float value)
+	{
+		float clamped = std::max(0.0f, std::min(1.0f, value));
+		return (unsigned short)std::lround(clamped * 65535.0f);
+	}
+
+	glm::vec2 encodeOctahedral(const glm::vec3 &direction)
+	{
+		float l1 = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+		if (!(l1 > 0.0f))
+			return glm::vec2(0.0f, 0.0f);
+
+		glm::vec2 encoded(direction.x / l1, direction.y / l1);
+
+		//the lower half of the octahedron is folded out over the corners of the square
+		if (direction.z < 0.0f)
+		{
+			float x_sign = encoded.x >= 0.0f ? 1.0f : -1.0f;
+			float y_sign = encoded.y >= 0.0f ? 1.0f : -1.0f;
+			encoded = glm::vec2((1.0f - std::fabs(encoded.y)) * x_sign, (1.0f - std::fabs(encoded.x)) * y_sign);
+		}
+
+		return encoded;
+	}
+
+	glm::vec3 decodeOctahedral(const glm::vec2 &encoded)
+	{
+		glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+
+		if (direction.z < 0.0f)
+		{
+			float x_sign = direction.x >= 0.0f ? 1.0f : -1.0f;
+			float y_sign = direction.y >= 0.0f ? 1.0f : -1.0f;
+			float x = (1.0f - std::fabs(encoded.y)) * x_sign;
+			float y = (1.0f - std::fabs(encoded.x)) * y_sign;
+			direction.x = x;
+			direction.y = y;
+		}
+
+		return glm::normalize(direction);
+	}
+
+	packed_vertex_data packVertices(const mesh_data &mesh, vertex_format format)
+	{
+		packed_vertex_data packed;
+		packed.position_transform = glm::mat4(1.0f);
+		packed.position_type = format == VERTEX_PACKED_HALF ? GL_HALF_FLOAT : GL_SHORT;
+		packed.uv_type = GL_UNSIGNED_SHORT;
+
+		array_view<vertex_data> vertices = mesh.getVertices();
+		array_view<glm::vec4> tangents = mesh.getVertexTangents();
+
+		if (vertices.empty())
+			return packed;
+
+		glm::vec3 bounds_min(vertices[0].xyzw), bounds_max(vertices[0].xyzw);
+		bool uvs_in_unit_range = true;
+
+		for (const vertex_data &vertex : vertices)
+		{
+			bounds_min = glm::min(bounds_min, glm::vec3(vertex.xyzw));
+			bounds_max = glm::max(bounds_max, glm::vec3(vertex.xyzw));
+
+			if (vertex.uv.x < 0.0f || vertex.uv.x > 1.0f || vertex.uv.y < 0.0f || vertex.uv.y > 1.0f)
+				uvs_in_unit_range = false;
+		}
+
+		//tiled uvs don't fit unorm16, half floats keep them at a coarser precision instead
+		if (!uvs_in_unit_range)
+			packed.uv_type = GL_HALF_FLOAT;
+
+		//one scale for every axis, so the transform undoing it doesn't skew normals in the shader
+		glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+		glm::vec3 half_extent = (bounds_max - bounds_min) * 0.5f;
+		float scale = std::max(half_extent.x, std::max(half_extent.y, half_extent.z));
+
+		if (!(scale > 0.0f))
+			scale = 1.0f;
+
+		packed.position_transform[0][0] = scale;
+		packed.position_transform[1][1] = scale;
+		packed.position_transform[2][2] = scale;
+		packed.position_transform[3] = glm::vec4(center, 1.0f);
+
+		packed.vertices.resize(vertices.size());
+
+		for (std::size_t i = 0; i < vertices.size(); i++)
+		{
+			const vertex_data &vertex = vertices[i];
+			packed_vertex &out = packed.vertices[i];
+
+			glm::vec3 position = (glm::vec3(vertex.xyzw) - center) / scale;
+			for (int axis = 0; axis < 3; axis++)
+				out.position[axis] = format == VERTEX_PACKED_HALF ? floatToHalf(position[axis]) : floatToSnorm16(position[axis]);
+
+			out.position[3] = 0;
+
+			for (int axis = 0; axis < 2; axis++)
+				out.uv[axis] = uvs_in_unit_range ? floatToUnorm16(vertex.uv[axis]) : floatToHalf(vertex.uv[axis]);
+
+			glm::vec2 normal = encodeOctahedral(vertex.n_xyz);
+			out.normal[0] = floatToSnorm16(normal.x);
+			out.normal[1] = floatToSnorm16(normal.y);
+
+			glm::vec4 tangent = i < tangents.size() ? tangents[i] : glm::vec4(0.0f);
+			glm::vec2 encoded_tangent = encodeOctahedral(glm::vec3(tangent));
+			out.tangent[0] = floatToSnorm16(encoded_tangent.x);
+			out.tangent[1] = floatToSnorm16(encoded_tangent.y);
+			out.tangent[2] = floatToSnorm16(tangent.w < 0.0f ? -1.0f : 1.0f);
+			out.tangent[3] = 0;
+		}
+
+		return packed;
+	}
+}